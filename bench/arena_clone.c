@@ -0,0 +1,71 @@
+// Cost of forking a full LinearAllocator for a what-if pass: memcpy of the used region
+// into another arena against la_clone of a memfd arena. The copy is mutated in a few
+// places and thrown away, the way speculative processing usually ends.
+//
+// usage: arena_clone [megabytes]
+//	megabytes	- used size of the source arena, 1024 by default
+#include "../include/linear_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>					// strtoull
+#include <string.h>					// memcpy, memset
+#include <time.h>					// clock_gettime
+#include <unistd.h>					// sysconf
+
+#define MODIFIED_PAGES_PERCENT		1
+
+static double now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// touches every 100 / MODIFIED_PAGES_PERCENT page
+static void mutate(char *data, const size_t size, const size_t page_size)
+{
+	const size_t step = page_size * (100 / MODIFIED_PAGES_PERCENT);
+	for (size_t offset = 0; offset < size; offset += step)
+		data[offset]++;
+}
+
+int main(int argc, char **argv)
+{
+	const size_t size = ((argc > 1) ? strtoull(argv[1], NULL, 10) : 1024) << 20;
+	const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+	LinearAllocator source;
+	if (!la_init_shared(&source, size))
+		return 1;
+	char *data = la_alloc(&source, size);
+	memset(data, 0x5A, size);
+	printf("source arena %zu MiB, %d%% of pages modified in the copy\n", size >> 20, MODIFIED_PAGES_PERCENT);
+
+	// memcpy into a heap arena of the same size
+	double start = now_ms();
+	LinearAllocator copy;
+	la_init(&copy, size);
+	char *copied = la_alloc(&copy, size);
+	memcpy(copied, data, size);
+	const double copy_fork = now_ms() - start;
+	mutate(copied, size, page_size);
+	const double copy_total = now_ms() - start;
+	la_terminate(&copy);
+	const double copy_discard = now_ms() - start - copy_total;
+
+	start = now_ms();
+	LinearAllocator clone;
+	if (!la_clone(&clone, &source))
+		return 1;
+	const double clone_fork = now_ms() - start;
+	mutate(la_rebase(&clone, &source, data), size, page_size);
+	const double clone_total = now_ms() - start;
+	la_terminate(&clone);
+	const double clone_discard = now_ms() - start - clone_total;
+
+	printf("%-8s %12s %12s %12s\n", "", "fork ms", "+mutate ms", "discard ms");
+	printf("%-8s %12.3f %12.3f %12.3f\n", "memcpy", copy_fork, copy_total, copy_discard);
+	printf("%-8s %12.3f %12.3f %12.3f\n", "la_clone", clone_fork, clone_total, clone_discard);
+
+	la_terminate(&source);
+	return 0;
+}
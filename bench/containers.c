@@ -0,0 +1,245 @@
+// Insert and lookup throughput of arena containers (arena_containers.h) against
+// the same containers built on malloc/realloc/free. Arena is a virtual LinearAllocator,
+// so the array and the string builder grow in place without copying.
+//
+// usage: containers [count]
+//	count	- number of elements, 10 000 000 by default
+#include "../include/arena_containers.h"
+#include "../include/linear_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>					// malloc, realloc, free, strtoull
+#include <string.h>					// memcpy, memset
+#include <time.h>					// clock_gettime
+
+#define ARENA_SIZE			((size_t)16 << 30)		// reserved only
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// keys are spread like ids, not sequential
+static uint64_t key_of(const uint64_t i)
+{
+	return i * 0xD6E8FEB86659FD93ULL + 1;
+}
+
+//
+// MALLOC-BASED CONTAINERS
+// same growth policy and probing as the arena ones
+//
+typedef struct
+{
+	uint64_t *data;
+	size_t count, capacity;
+} MallocArray;
+
+static int marr_push(MallocArray *array, const uint64_t value)
+{
+	if (array->count == array->capacity)
+	{
+		const size_t capacity = array->capacity ? 2 * array->capacity : 16;
+		uint64_t *data = realloc(array->data, capacity * sizeof(uint64_t));
+		if (data == NULL)
+			return 0;
+		array->data = data;
+		array->capacity = capacity;
+	}
+	array->data[array->count++] = value;
+	return 1;
+}
+
+// the same entries and table layout as ArenaMap, only the block comes from malloc
+typedef struct
+{
+	struct MapEntry *entries;
+	uint8_t *occupied;
+	size_t count, capacity;
+	unsigned shift;
+} MallocMap;
+
+#define MMAP_HASH(map, key)		((size_t)(((key) * 0x9E3779B97F4A7C15ULL) >> (map)->shift))
+
+static int mmap_grow(MallocMap *map, const size_t capacity)
+{
+	struct MapEntry *entries = malloc(capacity * (sizeof(struct MapEntry) + 1));
+	if (entries == NULL)
+		return 0;
+
+	uint8_t *occupied = (uint8_t *)(entries + capacity);
+	memset(occupied, 0, capacity);
+
+	MallocMap grown = { entries, occupied, map->count, capacity, 64 - __builtin_ctzll(capacity) };
+	for (size_t i = 0; i < map->capacity; i++)
+	{
+		if (!map->occupied[i])
+			continue;
+
+		size_t index = MMAP_HASH(&grown, map->entries[i].key);
+		while (occupied[index])
+			index = (index + 1) & (capacity - 1);
+		occupied[index] = 1;
+		entries[index] = map->entries[i];
+	}
+	free(map->entries);
+	*map = grown;
+	return 1;
+}
+
+static int mmap_put(MallocMap *map, const uint64_t key, const uint64_t value)
+{
+	if ((map->count + 1) * 4 > map->capacity * 3 && !mmap_grow(map, map->capacity ? 2 * map->capacity : 8))
+		return 0;
+
+	size_t index = MMAP_HASH(map, key);
+	while (map->occupied[index])
+	{
+		if (map->entries[index].key == key)
+		{
+			map->entries[index].value = value;
+			return 1;
+		}
+		index = (index + 1) & (map->capacity - 1);
+	}
+	map->occupied[index]	= 1;
+	map->entries[index]		= (struct MapEntry){ key, value };
+	map->count++;
+	return 1;
+}
+
+static uint64_t *mmap_get(MallocMap *map, const uint64_t key)
+{
+	if (map->capacity == 0)
+		return NULL;
+
+	size_t index = MMAP_HASH(map, key);
+	while (map->occupied[index])
+	{
+		if (map->entries[index].key == key)
+			return &map->entries[index].value;
+		index = (index + 1) & (map->capacity - 1);
+	}
+	return NULL;
+}
+
+typedef struct
+{
+	char *data;
+	size_t length, capacity;
+} MallocString;
+
+static int mstr_append(MallocString *string, const char *text, const size_t length)
+{
+	if (string->length + length + 1 > string->capacity)
+	{
+		size_t capacity = string->capacity ? 2 * string->capacity : 16;
+		while (capacity < string->length + length + 1)
+			capacity *= 2;
+		char *data = realloc(string->data, capacity);
+		if (data == NULL)
+			return 0;
+		string->data = data;
+		string->capacity = capacity;
+	}
+	memcpy(string->data + string->length, text, length);
+	string->length += length;
+	string->data[string->length] = '\0';
+	return 1;
+}
+
+//
+// RUNS
+//
+static void report(const char *name, const double arena_ns, const double malloc_ns, const size_t count)
+{
+	printf("%-16s %10.2f %10.2f %+8.1f%%\n", name, arena_ns / count, malloc_ns / count, (malloc_ns / arena_ns - 1) * 100);
+}
+
+int main(int argc, char **argv)
+{
+	const size_t count = (argc > 1) ? strtoull(argv[1], NULL, 10) : 10000000;
+	const size_t map_count = count / 4;
+	const char *word = "header-name:";
+	const size_t word_length = strlen(word);
+	uint64_t checksum = 0;
+
+	LinearAllocator linear;
+	la_init_virtual(&linear, ARENA_SIZE, 0);
+	if (linear.start == NULL)
+		return 1;
+
+	printf("%zu elements, %zu map keys\n", count, map_count);
+	printf("%-16s %10s %10s %9s\n", "operation", "arena ns", "malloc ns", "speedup");
+
+	// array push
+	double start = now_ns();
+	ArenaArray array;
+	arr_init(&array, ARENA_LINEAR(&linear), sizeof(uint64_t), 0);
+	for (size_t i = 0; i < count; i++)
+		*(uint64_t *)arr_push(&array) = i;
+	const double arena_push = now_ns() - start;
+	checksum += ARR_AT(&array, uint64_t, count - 1);
+	la_reset(&linear);
+
+	start = now_ns();
+	MallocArray malloc_array = { 0 };
+	for (size_t i = 0; i < count; i++)
+		marr_push(&malloc_array, i);
+	const double malloc_push = now_ns() - start;
+	checksum += malloc_array.data[count - 1];
+	free(malloc_array.data);
+	report("array push", arena_push, malloc_push, count);
+
+	// map insert and lookup
+	start = now_ns();
+	ArenaMap map;
+	map_init(&map, ARENA_LINEAR(&linear), 0);
+	for (size_t i = 0; i < map_count; i++)
+		map_put(&map, key_of(i), i);
+	const double arena_insert = now_ns() - start;
+
+	start = now_ns();
+	for (size_t i = 0; i < map_count; i++)
+		checksum += *map_get(&map, key_of(i));
+	const double arena_lookup = now_ns() - start;
+	la_reset(&linear);
+
+	start = now_ns();
+	MallocMap malloc_map = { 0 };
+	for (size_t i = 0; i < map_count; i++)
+		mmap_put(&malloc_map, key_of(i), i);
+	const double malloc_insert = now_ns() - start;
+
+	start = now_ns();
+	for (size_t i = 0; i < map_count; i++)
+		checksum += *mmap_get(&malloc_map, key_of(i));
+	const double malloc_lookup = now_ns() - start;
+	free(malloc_map.entries);
+	report("map insert", arena_insert, malloc_insert, map_count);
+	report("map lookup", arena_lookup, malloc_lookup, map_count);
+
+	// string builder append
+	start = now_ns();
+	StringBuilder builder;
+	sb_init(&builder, ARENA_LINEAR(&linear), 0);
+	for (size_t i = 0; i < count; i++)
+		sb_append(&builder, word, word_length);
+	const double arena_append = now_ns() - start;
+	checksum += builder.length;
+	la_reset(&linear);
+
+	start = now_ns();
+	MallocString string = { 0 };
+	for (size_t i = 0; i < count; i++)
+		mstr_append(&string, word, word_length);
+	const double malloc_append = now_ns() - start;
+	checksum += string.length;
+	free(string.data);
+	report("string append", arena_append, malloc_append, count);
+
+	la_terminate(&linear);
+	printf("checksum %llu\n", (unsigned long long)checksum);
+	return 0;
+}
@@ -0,0 +1,171 @@
+// Local file-read pipeline: file of text records is read in 64 KiB chunks and split into
+// records that are handed to a consumer. usual way reads into a malloc'ed buffer and copies
+// every record into its own allocation, IoBufferPool reads into a pooled buffer and records
+// are slices of it. record cut by the end of a chunk is moved to the start of the next one.
+// file is read twice before measuring, so both runs come from page cache.
+//
+// usage: io_pipeline [megabytes]
+//	megabytes	- size of generated file, 256 by default
+#include "../include/io_buffer_pool.h"
+#include <fcntl.h>					// open
+#include <stdio.h>
+#include <stdlib.h>					// malloc, free, strtoull
+#include <string.h>					// memcpy, memchr
+#include <time.h>					// clock_gettime
+#include <unistd.h>					// read, write, close, unlink
+
+#define CHUNK_SIZE		(64 * 1024)
+#define MAX_RECORDS		(CHUNK_SIZE / 8)
+#define FILE_PATH		"/tmp/io_pipeline.data"
+
+static double now_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// lines of "id,name,value" of different lengths
+static int generate(const size_t size)
+{
+	const int fd = open(FILE_PATH, O_CREAT | O_TRUNC | O_WRONLY, 0600);
+	if (fd < 0)
+		return 0;
+
+	char *chunk = malloc(CHUNK_SIZE);
+	size_t written = 0;
+	unsigned long id = 0;
+	while (written < size)
+	{
+		size_t length = 0;
+		while (length + 64 < CHUNK_SIZE)
+		{
+			length += (size_t)snprintf(chunk + length, 64, "%lu,record-%0*lu,%lu\n", id, (int)(id % 24) + 1, id * 7, id * 31 % 1000003);
+			id++;
+		}
+		if (write(fd, chunk, length) != (ssize_t)length)
+			break;
+		written += length;
+	}
+	free(chunk);
+	close(fd);
+	return written >= size;
+}
+
+// what consumer does with a record: looks at a few bytes
+static unsigned long consume(const char *data, const size_t length)
+{
+	return length + (unsigned char)data[0] + (unsigned char)data[length - 1];
+}
+
+static unsigned long run_malloc(const int fd)
+{
+	char *chunk = malloc(CHUNK_SIZE);
+	char **records = malloc(MAX_RECORDS * sizeof(char *));
+	size_t *lengths = malloc(MAX_RECORDS * sizeof(size_t));
+	unsigned long checksum = 0;
+	size_t tail = 0;
+	ssize_t bytes;
+
+	while ((bytes = read(fd, chunk + tail, CHUNK_SIZE - tail)) > 0)
+	{
+		const size_t filled = tail + (size_t)bytes;
+		size_t num_of_records = 0, start = 0;
+		const char *newline;
+		while ((newline = memchr(chunk + start, '\n', filled - start)) != NULL)
+		{
+			const size_t length = (size_t)(newline - chunk) - start;
+			records[num_of_records] = malloc(length);
+			memcpy(records[num_of_records], chunk + start, length);
+			lengths[num_of_records++] = length;
+			start += length + 1;
+		}
+
+		for (size_t i = 0; i < num_of_records; i++)
+		{
+			checksum += consume(records[i], lengths[i]);
+			free(records[i]);
+		}
+
+		tail = filled - start;
+		memmove(chunk, chunk + start, tail);
+	}
+
+	free(lengths);
+	free(records);
+	free(chunk);
+	return checksum;
+}
+
+static unsigned long run_pool(IoBufferPool *pool, const int fd)
+{
+	IoSlice *records = malloc(MAX_RECORDS * sizeof(IoSlice));
+	unsigned long checksum = 0;
+	IoBuffer *buffer = iop_acquire(pool);
+
+	while (iop_read(buffer, fd, -1) > 0)
+	{
+		size_t num_of_records = 0, start = 0;
+		const char *newline;
+		while ((newline = memchr(buffer->data + start, '\n', buffer->length - start)) != NULL)
+		{
+			const size_t length = (size_t)(newline - buffer->data) - start;
+			records[num_of_records++] = iop_slice(buffer, start, length);
+			start += length + 1;
+		}
+
+		// next buffer is taken before records let the current one go
+		IoBuffer *next = iop_acquire(pool);
+		next->length = buffer->length - start;
+		memcpy(next->data, buffer->data + start, next->length);
+		iop_release(buffer);
+		buffer = next;
+
+		for (size_t i = 0; i < num_of_records; i++)
+		{
+			checksum += consume(records[i].data, records[i].length);
+			iop_release_slice(&records[i]);
+		}
+	}
+
+	iop_release(buffer);
+	free(records);
+	return checksum;
+}
+
+int main(int argc, char **argv)
+{
+	const size_t size = ((argc > 1) ? strtoull(argv[1], NULL, 10) : 256) << 20;
+	if (!generate(size))
+	{
+		printf("can't write %s\n", FILE_PATH);
+		return 1;
+	}
+
+	IoBufferPool pool;
+	iop_init(&pool, 4, CHUNK_SIZE);
+
+	unsigned long checksums[2];
+	double times[2];
+	for (int pass = 0; pass < 3; pass++)
+	{
+		for (int variant = 0; variant < 2; variant++)
+		{
+			const int fd = open(FILE_PATH, O_RDONLY);
+			const double start = now_ms();
+			checksums[variant] = variant == 0 ? run_malloc(fd) : run_pool(&pool, fd);
+			times[variant] = now_ms() - start;
+			close(fd);
+		}
+	}
+
+	printf("%zu MiB of records, chunks of %d KiB\n", size >> 20, CHUNK_SIZE >> 10);
+	printf("read + malloc copies:  %8.1f ms  %7.1f MiB/s\n", times[0], (size >> 20) / times[0] * 1e3);
+	printf("pool buffer + slices:  %8.1f ms  %7.1f MiB/s\n", times[1], (size >> 20) / times[1] * 1e3);
+	if (checksums[0] != checksums[1])
+		printf("checksums differ: %lu %lu\n", checksums[0], checksums[1]);
+
+	iop_terminate(&pool);
+	unlink(FILE_PATH);
+	return 0;
+}
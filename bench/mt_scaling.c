@@ -0,0 +1,497 @@
+// Multithreaded scaling and tail latency of allocator modes against glibc malloc.
+//	churn			- every thread allocates a batch and frees it, nothing crosses threads
+//	producer/consumer	- pairs of threads, producer allocates and consumer frees
+//	cross-thread free	- ring of threads, each frees what the previous one allocated
+// alloc and free calls are timed one by one into log-bucketed histograms (4 bits of precision,
+// about 6%), clock_gettime around each call is part of the latency. throughput counts alloc
+// and free calls of all threads per wall second, scaling is relative to the first thread count.
+// plain pool per thread can't take frees from other threads and skips those workloads, pools
+// with an owner thread take them through remote free lists, alloc_free finds the owner pool.
+//
+// usage: mt_scaling [operations] [max threads]
+//	operations	- allocations per thread, 262144 by default
+//	max threads	- number of online CPUs by default, thread counts go 1, 2, 4 ... max
+#include "../include/pool_allocator.h"
+#include "../include/shared_pool_allocator.h"
+#include "../include/owner_registry.h"		// alloc_free
+#include <pthread.h>
+#include <sched.h>					// sched_yield
+#include <stdatomic.h>
+#include <stdint.h>					// uint64_t
+#include <stdio.h>
+#include <stdlib.h>					// malloc, free, strtoull, exit
+#include <string.h>					// memset
+#include <time.h>					// clock_gettime
+#include <unistd.h>					// sysconf
+
+#define OBJECT_SIZE		64
+#define CHURN_BATCH		64
+#define RING_SIZE		1024				// power of two
+#define CACHE_LINE_SIZE		64
+
+//
+// HISTOGRAM
+// values below 16 have own buckets, above that 16 buckets per power of two
+//
+#define SUB_BUCKETS		16
+#define NUM_OF_BUCKETS		(61 * SUB_BUCKETS)
+
+typedef struct
+{
+	uint64_t counts[NUM_OF_BUCKETS];
+	uint64_t total;
+	uint64_t max;
+} Histogram;
+
+static int bucket_of(const uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+		return (int)value;
+	const int exponent = 63 - __builtin_clzll(value);
+	return (exponent - 3) * SUB_BUCKETS + (int)((value >> (exponent - 4)) & (SUB_BUCKETS - 1));
+}
+
+// highest value that falls into the bucket
+static uint64_t bucket_limit(const int bucket)
+{
+	if (bucket < SUB_BUCKETS)
+		return (uint64_t)bucket;
+	const int exponent = bucket / SUB_BUCKETS + 3;
+	return (((uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS + 1)) << (exponent - 4)) - 1;
+}
+
+static void histogram_record(Histogram *histogram, const uint64_t value)
+{
+	histogram->counts[bucket_of(value)]++;
+	histogram->total++;
+	if (value > histogram->max)
+		histogram->max = value;
+}
+
+static void histogram_add(Histogram *to, const Histogram *from)
+{
+	for (int i = 0; i < NUM_OF_BUCKETS; i++)
+		to->counts[i] += from->counts[i];
+	to->total += from->total;
+	if (from->max > to->max)
+		to->max = from->max;
+}
+
+static uint64_t histogram_percentile(const Histogram *histogram, const double percent)
+{
+	const uint64_t rank = (uint64_t)(histogram->total * percent / 100);
+	uint64_t seen = 0;
+	for (int i = 0; i < NUM_OF_BUCKETS; i++)
+	{
+		seen += histogram->counts[i];
+		if (seen > rank)
+			return bucket_limit(i) < histogram->max ? bucket_limit(i) : histogram->max;
+	}
+	return histogram->max;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+//
+// ALLOCATOR MODES
+//
+typedef struct
+{
+	const char *name;
+	void *(*create)(const size_t num_of_elements);
+	void *(*alloc)(void *state);
+	void (*free)(void *state, void *ptr);
+	void (*destroy)(void *state);
+	int per_thread;				// every thread creates its own state
+	int remote_free;			// per-thread state takes frees from other threads
+} Mode;
+
+static void *malloc_create(const size_t num_of_elements)	{ return NULL; }
+static void *malloc_alloc(void *state)				{ return malloc(OBJECT_SIZE); }
+static void malloc_free(void *state, void *ptr)			{ free(ptr); }
+static void malloc_destroy(void *state)				{ }
+
+// one pool behind a global lock, the way thread-owned pools are shared today
+struct LockedPool
+{
+	PoolAllocator pool;
+	pthread_mutex_t lock;
+};
+
+static void *locked_create(const size_t num_of_elements)
+{
+	struct LockedPool *state = malloc(sizeof(struct LockedPool));
+	pa_init(&state->pool, num_of_elements, OBJECT_SIZE);
+	pthread_mutex_init(&state->lock, NULL);
+	return state;
+}
+
+static void *locked_alloc(void *state)
+{
+	struct LockedPool *locked = state;
+	pthread_mutex_lock(&locked->lock);
+	void *ptr = pa_alloc(&locked->pool);
+	pthread_mutex_unlock(&locked->lock);
+	return ptr;
+}
+
+static void locked_free(void *state, void *ptr)
+{
+	struct LockedPool *locked = state;
+	pthread_mutex_lock(&locked->lock);
+	pa_free(&locked->pool, ptr);
+	pthread_mutex_unlock(&locked->lock);
+}
+
+static void locked_destroy(void *state)
+{
+	struct LockedPool *locked = state;
+	pa_terminate(&locked->pool);
+	pthread_mutex_destroy(&locked->lock);
+	free(locked);
+}
+
+static void *local_create(const size_t num_of_elements)
+{
+	PoolAllocator *pool = malloc(sizeof(PoolAllocator));
+	pa_init(pool, num_of_elements, OBJECT_SIZE);
+	return pool;
+}
+
+static void *local_alloc(void *state)			{ return pa_alloc(state); }
+static void local_free(void *state, void *ptr)		{ pa_free(state, ptr); }
+static void local_destroy(void *state)			{ pa_terminate(state); free(state); }
+
+static void *owned_create(const size_t num_of_elements)
+{
+	PoolAllocator *pool = local_create(num_of_elements);
+	pa_set_owner(pool);
+	return pool;
+}
+
+static void owned_free(void *state, void *ptr)		{ alloc_free(ptr); }
+
+static void *shared_create(const size_t num_of_elements)
+{
+	SharedPoolAllocator *pool = malloc(sizeof(SharedPoolAllocator));
+	if (!spa_create(pool, NULL, num_of_elements, OBJECT_SIZE))
+	{
+		printf("can't create shared pool\n");
+		exit(1);
+	}
+	return pool;
+}
+
+static void *shared_alloc(void *state)			{ return spa_alloc(state); }
+static void shared_free(void *state, void *ptr)		{ spa_free(state, ptr); }
+static void shared_destroy(void *state)			{ spa_detach(state); free(state); }
+
+static const Mode modes[] =
+{
+	{ "malloc",		malloc_create,	malloc_alloc,	malloc_free,	malloc_destroy,	0, 0 },
+	{ "pa + mutex",		locked_create,	locked_alloc,	locked_free,	locked_destroy,	0, 0 },
+	{ "spa lock-free",	shared_create,	shared_alloc,	shared_free,	shared_destroy,	0, 0 },
+	{ "pa per thread",	local_create,	local_alloc,	local_free,	local_destroy,	1, 0 },
+	{ "pa remote free",	owned_create,	local_alloc,	owned_free,	local_destroy,	1, 1 },
+};
+#define NUM_OF_MODES		(sizeof(modes) / sizeof(modes[0]))
+
+//
+// WORKERS
+//
+
+// single producer, single consumer. waiting threads yield, runs may have more threads than CPUs
+struct Ring
+{
+	_Alignas(CACHE_LINE_SIZE) _Atomic size_t head;
+	_Alignas(CACHE_LINE_SIZE) _Atomic size_t tail;
+	void *slots[RING_SIZE];
+};
+
+static int ring_push(struct Ring *ring, void *ptr)
+{
+	const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == RING_SIZE)
+		return 0;
+	ring->slots[head & (RING_SIZE - 1)] = ptr;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	return 1;
+}
+
+static void *ring_pop(struct Ring *ring)
+{
+	const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if (tail == atomic_load_explicit(&ring->head, memory_order_acquire))
+		return NULL;
+	void *ptr = ring->slots[tail & (RING_SIZE - 1)];
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	return ptr;
+}
+
+typedef enum { CHURN, PRODUCER_CONSUMER, CROSS_THREAD_FREE, NUM_OF_WORKLOADS } Workload;
+
+static const char *workload_names[NUM_OF_WORKLOADS] = { "churn", "producer/consumer", "cross-thread free" };
+
+struct Run;
+
+typedef struct
+{
+	_Alignas(CACHE_LINE_SIZE) struct Ring inbox;
+	Histogram histogram;
+	struct Run *run;
+	void *state;					// of per-thread modes
+	_Atomic size_t skipped;				// producer/consumer: failed allocations of the producer
+	pthread_t thread;
+	int id;
+} Worker;
+
+struct Run
+{
+	const Mode *mode;
+	Workload workload;
+	Worker *workers;
+	int num_of_threads;
+	size_t operations;
+	void *shared_state;
+	_Atomic size_t freed;				// cross-thread free: objects freed by all threads
+	pthread_barrier_t start;
+	int failed;
+};
+
+static void *timed_alloc(const Mode *mode, void *state, Histogram *histogram)
+{
+	const uint64_t start = now_ns();
+	void *ptr = mode->alloc(state);
+	histogram_record(histogram, now_ns() - start);
+	return ptr;
+}
+
+static void timed_free(const Mode *mode, void *state, void *ptr, Histogram *histogram)
+{
+	const uint64_t start = now_ns();
+	mode->free(state, ptr);
+	histogram_record(histogram, now_ns() - start);
+}
+
+static void churn(Worker *worker, void *state)
+{
+	struct Run *run = worker->run;
+	void *batch[CHURN_BATCH];
+	for (size_t done = 0; done < run->operations; done += CHURN_BATCH)
+	{
+		for (int i = 0; i < CHURN_BATCH; i++)
+		{
+			batch[i] = timed_alloc(run->mode, state, &worker->histogram);
+			if (batch[i] == NULL)
+				run->failed = 1;
+		}
+		for (int i = CHURN_BATCH - 1; i >= 0; i--)
+		{
+			if (batch[i] != NULL)
+				timed_free(run->mode, state, batch[i], &worker->histogram);
+		}
+	}
+}
+
+// even threads produce for the next odd one
+static void producer_consumer(Worker *worker, void *state)
+{
+	struct Run *run = worker->run;
+	if (worker->id % 2 == 0)
+	{
+		Worker *consumer = &run->workers[worker->id + 1];
+		for (size_t i = 0; i < run->operations; i++)
+		{
+			// NULL in the ring means empty, consumer counts failed allocations instead
+			void *ptr = timed_alloc(run->mode, state, &worker->histogram);
+			if (ptr == NULL)
+			{
+				run->failed = 1;
+				atomic_fetch_add_explicit(&consumer->skipped, 1, memory_order_relaxed);
+				continue;
+			}
+			while (!ring_push(&consumer->inbox, ptr))
+				sched_yield();
+		}
+	}
+	else
+	{
+		size_t consumed = 0;
+		while (consumed + atomic_load_explicit(&worker->skipped, memory_order_relaxed) < run->operations)
+		{
+			void *ptr = ring_pop(&worker->inbox);
+			if (ptr == NULL)
+			{
+				sched_yield();
+				continue;
+			}
+			timed_free(run->mode, state, ptr, &worker->histogram);
+			consumed++;
+		}
+	}
+}
+
+static size_t drain(Worker *worker, void *state)
+{
+	size_t freed = 0;
+	void *ptr;
+	while ((ptr = ring_pop(&worker->inbox)) != NULL)
+	{
+		timed_free(worker->run->mode, state, ptr, &worker->histogram);
+		freed++;
+	}
+	atomic_fetch_add_explicit(&worker->run->freed, freed, memory_order_relaxed);
+	return freed;
+}
+
+static void cross_thread_free(Worker *worker, void *state)
+{
+	struct Run *run = worker->run;
+	struct Ring *next = &run->workers[(worker->id + 1) % run->num_of_threads].inbox;
+	for (size_t i = 0; i < run->operations; i++)
+	{
+		void *ptr = timed_alloc(run->mode, state, &worker->histogram);
+		if (ptr == NULL)
+		{
+			run->failed = 1;
+			atomic_fetch_add_explicit(&run->freed, 1, memory_order_relaxed);
+			continue;
+		}
+
+		// full ring of the next thread: free own inbox meanwhile, rings can't all stay full
+		while (!ring_push(next, ptr))
+		{
+			if (drain(worker, state) == 0)
+				sched_yield();
+		}
+	}
+
+	const size_t total = run->operations * run->num_of_threads;
+	while (atomic_load_explicit(&run->freed, memory_order_relaxed) < total)
+	{
+		if (drain(worker, state) == 0)
+			sched_yield();
+	}
+}
+
+static void *worker_main(void *argument)
+{
+	Worker *worker = argument;
+	struct Run *run = worker->run;
+	// objects of a thread may wait in the next inbox while it holds a batch
+	void *state = run->mode->per_thread ? run->mode->create(RING_SIZE + CHURN_BATCH + 1) : run->shared_state;
+	worker->state = state;
+
+	pthread_barrier_wait(&run->start);
+	switch (run->workload)
+	{
+		case CHURN:			churn(worker, state); break;
+		case PRODUCER_CONSUMER:		producer_consumer(worker, state); break;
+		case CROSS_THREAD_FREE:		cross_thread_free(worker, state); break;
+		default: break;
+	}
+	pthread_barrier_wait(&run->start);
+	return NULL;
+}
+
+// returns alloc and free calls per second, 0 if mode couldn't serve the workload
+static double run_workload(const Mode *mode, const Workload workload, const int num_of_threads, const size_t operations, Histogram *histogram)
+{
+	struct Run run;
+	run.mode		= mode;
+	run.workload		= workload;
+	run.num_of_threads	= num_of_threads;
+	run.operations		= operations;
+	run.failed		= 0;
+	atomic_init(&run.freed, 0);
+
+	// every thread may have a batch out and a full inbox
+	run.shared_state = mode->per_thread ? NULL : mode->create((size_t)num_of_threads * (RING_SIZE + CHURN_BATCH + 1));
+
+	if (posix_memalign((void **)&run.workers, CACHE_LINE_SIZE, num_of_threads * sizeof(Worker)) != 0)
+		return 0;
+	memset(run.workers, 0, num_of_threads * sizeof(Worker));
+	pthread_barrier_init(&run.start, NULL, num_of_threads + 1);
+
+	for (int i = 0; i < num_of_threads; i++)
+	{
+		run.workers[i].run	= &run;
+		run.workers[i].id	= i;
+		pthread_create(&run.workers[i].thread, NULL, worker_main, &run.workers[i]);
+	}
+
+	pthread_barrier_wait(&run.start);
+	const uint64_t start = now_ns();
+	pthread_barrier_wait(&run.start);
+	const uint64_t elapsed = now_ns() - start;
+
+	memset(histogram, 0, sizeof(Histogram));
+	for (int i = 0; i < num_of_threads; i++)
+	{
+		pthread_join(run.workers[i].thread, NULL);
+		histogram_add(histogram, &run.workers[i].histogram);
+	}
+
+	// other threads may free into pools of threads that finished earlier
+	for (int i = 0; i < num_of_threads && mode->per_thread; i++)
+		mode->destroy(run.workers[i].state);
+
+	pthread_barrier_destroy(&run.start);
+	free(run.workers);
+	if (!mode->per_thread)
+		mode->destroy(run.shared_state);
+	return run.failed ? 0 : (double)histogram->total / ((double)elapsed / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+	const size_t operations = (argc > 1) ? strtoull(argv[1], NULL, 10) : (size_t)1 << 18;
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const int max_threads = (argc > 2) ? atoi(argv[2]) : (cpus > 0 ? (int)cpus : 1);
+
+	Histogram *histogram = malloc(sizeof(Histogram));
+	printf("%zu operations per thread, %d-byte objects, latency in ns\n", operations, OBJECT_SIZE);
+
+	for (int workload = 0; workload < NUM_OF_WORKLOADS; workload++)
+	{
+		printf("\n%s\n%-16s %8s %10s %8s %8s %8s %8s %10s\n", workload_names[workload],
+			"", "threads", "Mops/s", "scaling", "p50", "p99", "p99.9", "max");
+
+		for (size_t m = 0; m < NUM_OF_MODES; m++)
+		{
+			const Mode *mode = &modes[m];
+			if (mode->per_thread && !mode->remote_free && workload != CHURN)
+			{
+				printf("%-16s %8s\n", mode->name, "-");
+				continue;
+			}
+
+			// producer/consumer needs pairs
+			double first = 0;
+			const int min_threads = (workload == PRODUCER_CONSUMER) ? 2 : 1;
+			for (int threads = min_threads; threads <= (max_threads > min_threads ? max_threads : min_threads); threads *= 2)
+			{
+				const double throughput = run_workload(mode, (Workload)workload, threads, operations, histogram);
+				if (throughput == 0)
+				{
+					printf("%-16s %8d %10s\n", mode->name, threads, "failed");
+					continue;
+				}
+				if (first == 0)
+					first = throughput;
+
+				printf("%-16s %8d %10.2f %7.2fx %8lu %8lu %8lu %10lu\n", mode->name, threads, throughput / 1e6, throughput / first,
+					histogram_percentile(histogram, 50), histogram_percentile(histogram, 99),
+					histogram_percentile(histogram, 99.9), histogram->max);
+			}
+		}
+	}
+
+	free(histogram);
+	return 0;
+}
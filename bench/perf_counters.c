@@ -0,0 +1,308 @@
+// Hardware counters per allocator operation: every workload runs between enabling and disabling
+// perf_event_open counters of this thread, values are divided by number of alloc and free calls.
+// counters the kernel refuses (containers, VMs, perf_event_paranoid > 2) are shown as n/a,
+// the time column is always there. counters are opened one by one, so one missing event
+// doesn't take the others with it; multiplexed values are scaled by enabled / running time.
+// every returned block gets one word written, like a caller would, so untouched memory faults in.
+//
+// usage: perf_counters [operations]
+//	operations	- allocations per round, 1048576 by default
+#include "../include/linear_allocator.h"
+#include "../include/stack_allocator.h"
+#include "../include/pool_allocator.h"
+#include "../include/double_buffered_allocator.h"
+#include "../include/double_ended_stack_allocator.h"
+#include <errno.h>
+#include <linux/perf_event.h>				// perf_event_attr, PERF_*
+#include <stdint.h>					// uint64_t
+#include <stdio.h>
+#include <stdlib.h>					// malloc, free, strtoull
+#include <string.h>					// memset, strerror
+#include <sys/ioctl.h>					// ioctl
+#include <sys/syscall.h>				// SYS_perf_event_open
+#include <time.h>					// clock_gettime
+#include <unistd.h>					// syscall, read, close
+
+#define ROUNDS			8
+#define STACK_DEPTH		16
+#define FRAME_ALLOCATIONS	1024
+#define ALLOCATION_SIZE		64
+
+#define CACHE_EVENT(cache, op, result)	((cache) | ((op) << 8) | ((result) << 16))
+
+typedef struct
+{
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} CounterSpec;
+
+static const CounterSpec counter_specs[] =
+{
+	{ "cycles",		PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions",	PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS },
+	{ "L1d-miss",		PERF_TYPE_HW_CACHE,	CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "LLC-miss",		PERF_TYPE_HW_CACHE,	CACHE_EVENT(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "dTLB-miss",		PERF_TYPE_HW_CACHE,	CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "page-fault",		PERF_TYPE_SOFTWARE,	PERF_COUNT_SW_PAGE_FAULTS },
+};
+#define NUM_OF_COUNTERS		(sizeof(counter_specs) / sizeof(counter_specs[0]))
+
+typedef struct
+{
+	int fds[NUM_OF_COUNTERS];			// -1 if event is unavailable
+	double values[NUM_OF_COUNTERS];			// -1 if event didn't run
+	double start_ns;
+	double elapsed_ns;
+} Counters;
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// user space of this thread only, that's what perf_event_paranoid 2 allows
+static int open_counter(const CounterSpec *spec)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size		= sizeof(attr);
+	attr.type		= spec->type;
+	attr.config		= spec->config;
+	attr.disabled		= 1;
+	attr.exclude_kernel	= 1;
+	attr.exclude_hv		= 1;
+	attr.read_format	= PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counters_open(Counters *counters)
+{
+	int available = 0;
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+	{
+		counters->fds[i] = open_counter(&counter_specs[i]);
+		if (counters->fds[i] < 0)
+			printf("%s is unavailable: %s\n", counter_specs[i].name, strerror(errno));
+		else
+			available++;
+	}
+	if (available == 0)
+		printf("no counters, check /proc/sys/kernel/perf_event_paranoid or run outside of container\n");
+}
+
+static void counters_close(Counters *counters)
+{
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+	{
+		if (counters->fds[i] >= 0)
+			close(counters->fds[i]);
+	}
+}
+
+static void counters_start(Counters *counters)
+{
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+	{
+		if (counters->fds[i] >= 0)
+		{
+			ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+	counters->start_ns = now_ns();
+}
+
+static void counters_stop(Counters *counters)
+{
+	counters->elapsed_ns = now_ns() - counters->start_ns;
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+	{
+		counters->values[i] = -1;
+		if (counters->fds[i] < 0)
+			continue;
+
+		ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		uint64_t data[3];				// value, time enabled, time running
+		if (read(counters->fds[i], data, sizeof(data)) == sizeof(data) && data[2] > 0)
+			counters->values[i] = (double)data[0] * (double)data[1] / (double)data[2];
+	}
+}
+
+static void print_header(void)
+{
+	printf("\n%-22s %10s", "per operation", "ns");
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+		printf(" %12s", counter_specs[i].name);
+	printf("\n");
+}
+
+static void print_row(const char *name, const Counters *counters, const size_t operations)
+{
+	printf("%-22s %10.2f", name, counters->elapsed_ns / operations);
+	for (size_t i = 0; i < NUM_OF_COUNTERS; i++)
+	{
+		if (counters->values[i] < 0)
+			printf(" %12s", "n/a");
+		else
+			printf(" %12.4f", counters->values[i] / operations);
+	}
+	printf("\n");
+}
+
+// fresh arena, first round takes page faults
+static size_t run_linear(Counters *counters, const size_t n)
+{
+	LinearAllocator allocator;
+	la_init(&allocator, n * ALLOCATION_SIZE);
+
+	counters_start(counters);
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		for (size_t i = 0; i < n; i++)
+			*(size_t *)la_alloc(&allocator, ALLOCATION_SIZE) = i;
+		la_reset(&allocator);
+	}
+	counters_stop(counters);
+
+	la_terminate(&allocator);
+	return ROUNDS * n;
+}
+
+// nested scopes: STACK_DEPTH allocations freed in reverse order
+static size_t run_stack(Counters *counters, const size_t n)
+{
+	StackAllocator allocator;
+	sa_init(&allocator, STACK_DEPTH * 2 * ALLOCATION_SIZE);
+	void *blocks[STACK_DEPTH];
+
+	counters_start(counters);
+	for (size_t i = 0; i < ROUNDS * n / STACK_DEPTH; i++)
+	{
+		for (int depth = 0; depth < STACK_DEPTH; depth++)
+		{
+			blocks[depth] = sa_alloc(&allocator, ALLOCATION_SIZE);
+			*(size_t *)blocks[depth] = i;
+		}
+		for (int depth = STACK_DEPTH - 1; depth >= 0; depth--)
+			sa_free(&allocator, blocks[depth]);
+	}
+	counters_stop(counters);
+
+	sa_terminate(&allocator);
+	return 2 * (ROUNDS * n / STACK_DEPTH) * STACK_DEPTH;
+}
+
+// elements freed in shuffled order, free list ends up scattered over the pool
+static size_t run_pool(Counters *counters, const size_t n)
+{
+	PoolAllocator allocator;
+	pa_init(&allocator, n, ALLOCATION_SIZE);
+	void **elements = malloc(n * sizeof(void *));
+	size_t *order = malloc(n * sizeof(size_t));
+	uint64_t random = 0x9E3779B97F4A7C15ULL;
+	for (size_t i = 0; i < n; i++)
+		order[i] = i;
+	for (size_t i = n - 1; i > 0; i--)
+	{
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		const size_t j = random % (i + 1);
+		const size_t swap = order[i];
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	counters_start(counters);
+	for (int round = 0; round < ROUNDS; round++)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			elements[i] = pa_alloc(&allocator);
+			*(size_t *)elements[i] = i;
+		}
+		for (size_t i = 0; i < n; i++)
+			pa_free(&allocator, elements[order[i]]);
+	}
+	counters_stop(counters);
+
+	free(order);
+	free(elements);
+	pa_terminate(&allocator);
+	return 2 * ROUNDS * n;
+}
+
+// per-frame allocations, swap keeps the older frame, so the buffer switched to is reset
+static size_t run_double_buffered(Counters *counters, const size_t n)
+{
+	DoubleBufferedAllocator allocator;
+	dba_init(&allocator, FRAME_ALLOCATIONS * 2 * ALLOCATION_SIZE);
+
+	counters_start(counters);
+	for (size_t frame = 0; frame < ROUNDS * n / FRAME_ALLOCATIONS; frame++)
+	{
+		for (int i = 0; i < FRAME_ALLOCATIONS; i++)
+			*(size_t *)dba_alloc(&allocator, ALLOCATION_SIZE) = frame;
+		dba_swap_buffers(&allocator);
+		dba_reset(&allocator);
+	}
+	counters_stop(counters);
+
+	dba_terminate(&allocator);
+	return (ROUNDS * n / FRAME_ALLOCATIONS) * FRAME_ALLOCATIONS;
+}
+
+// both ends grow and shrink in turns
+static size_t run_double_ended(Counters *counters, const size_t n)
+{
+	DoubleEndedStackAllocator allocator;
+	desa_init(&allocator, STACK_DEPTH * 4 * ALLOCATION_SIZE);
+	void *front[STACK_DEPTH], *back[STACK_DEPTH];
+
+	counters_start(counters);
+	for (size_t i = 0; i < ROUNDS * n / (2 * STACK_DEPTH); i++)
+	{
+		for (int depth = 0; depth < STACK_DEPTH; depth++)
+		{
+			front[depth] = desa_front_alloc(&allocator, ALLOCATION_SIZE);
+			back[depth] = desa_back_alloc(&allocator, ALLOCATION_SIZE);
+			*(size_t *)front[depth] = *(size_t *)back[depth] = i;
+		}
+		for (int depth = STACK_DEPTH - 1; depth >= 0; depth--)
+		{
+			desa_back_free(&allocator, back[depth]);
+			desa_front_free(&allocator, front[depth]);
+		}
+	}
+	counters_stop(counters);
+
+	desa_terminate(&allocator);
+	return 4 * (ROUNDS * n / (2 * STACK_DEPTH)) * STACK_DEPTH;
+}
+
+int main(int argc, char **argv)
+{
+	const size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : (size_t)1 << 20;
+
+	Counters counters;
+	counters_open(&counters);
+	printf("%zu allocations of %d bytes per round, %d rounds", n, ALLOCATION_SIZE, ROUNDS);
+	print_header();
+
+	size_t operations = run_linear(&counters, n);
+	print_row("la_alloc", &counters, operations);
+	operations = run_stack(&counters, n);
+	print_row("sa_alloc + sa_free", &counters, operations);
+	operations = run_pool(&counters, n);
+	print_row("pa_alloc + pa_free", &counters, operations);
+	operations = run_double_buffered(&counters, n);
+	print_row("dba_alloc + swap", &counters, operations);
+	operations = run_double_ended(&counters, n);
+	print_row("desa_front/back", &counters, operations);
+
+	counters_close(&counters);
+	return 0;
+}
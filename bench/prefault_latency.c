@@ -0,0 +1,93 @@
+// Latency of allocate-and-write from a fresh LinearAllocator with and without la_prefault.
+// fresh arena takes a minor page fault on the first write to every page, so one request in
+// every 4 KiB / ALLOCATION_SIZE pays a few microseconds. prefaulted arena moves this cost to
+// startup. histogram buckets are powers of two nanoseconds.
+//
+// usage: prefault_latency [megabytes]
+//	megabytes	- size of the arena, 256 by default
+#include "../include/linear_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>					// strtoull
+#include <string.h>					// memset
+#include <time.h>					// clock_gettime
+
+#define ALLOCATION_SIZE		256
+#define NUM_OF_BUCKETS		32
+
+typedef struct
+{
+	size_t buckets[NUM_OF_BUCKETS];
+	size_t count;
+	double max;
+} Histogram;
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void record(Histogram *histogram, const double ns)
+{
+	int bucket = 0;
+	while (bucket < NUM_OF_BUCKETS - 1 && ((size_t)1 << (bucket + 1)) <= ns)
+		bucket++;
+	histogram->buckets[bucket]++;
+	histogram->count++;
+	if (ns > histogram->max)
+		histogram->max = ns;
+}
+
+// upper bound of the bucket that holds the percentile
+static size_t percentile(const Histogram *histogram, const double percent)
+{
+	const size_t rank = (size_t)(histogram->count * percent / 100);
+	size_t seen = 0;
+	for (int bucket = 0; bucket < NUM_OF_BUCKETS; bucket++)
+	{
+		seen += histogram->buckets[bucket];
+		if (seen > rank)
+			return (size_t)1 << (bucket + 1);
+	}
+	return (size_t)1 << NUM_OF_BUCKETS;
+}
+
+static void run(const char *name, const size_t size, const int is_virtual, const int prefault)
+{
+	LinearAllocator allocator;
+	if (is_virtual)
+		la_init_virtual(&allocator, size, 0);
+	else
+		la_init(&allocator, size);
+
+	double setup = now_ns();
+	if (prefault)
+		la_prefault(&allocator, 0);
+	setup = now_ns() - setup;
+
+	Histogram histogram = { 0 };
+	for (size_t i = 0; i < size / ALLOCATION_SIZE; i++)
+	{
+		const double start = now_ns();
+		char *ptr = la_alloc(&allocator, ALLOCATION_SIZE);
+		memset(ptr, (int)i, ALLOCATION_SIZE);
+		record(&histogram, now_ns() - start);
+	}
+
+	printf("%-20s %10.1f %8zu %8zu %8zu %10.0f\n", name, setup / 1e6,
+		percentile(&histogram, 50), percentile(&histogram, 99), percentile(&histogram, 99.9), histogram.max);
+	la_terminate(&allocator);
+}
+
+int main(int argc, char **argv)
+{
+	const size_t size = ((argc > 1) ? strtoull(argv[1], NULL, 10) : 256) << 20;
+	printf("%zu MiB arena, %d-byte allocations, latency in ns (bucket upper bound)\n", size >> 20, ALLOCATION_SIZE);
+	printf("%-20s %10s %8s %8s %8s %10s\n", "", "setup ms", "p50", "p99", "p99.9", "max");
+	run("heap", size, 0, 0);
+	run("heap + prefault", size, 0, 1);
+	run("virtual", size, 1, 0);
+	run("virtual + prefault", size, 1, 1);
+	return 0;
+}
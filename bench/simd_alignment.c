@@ -0,0 +1,103 @@
+// Shows what allocation alignment means for a SIMD kernel: y = a * x + y over float arrays
+// taken from LinearAllocator with la_alloc_aligned(64) and shifted by 4 bytes off cache line,
+// the way addresses came out when only sizes were aligned.
+//
+// usage: simd_alignment
+#include "../include/linear_allocator.h"
+#include <stdio.h>
+#include <time.h>					// clock_gettime
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <immintrin.h>
+	#define HAS_X86_SIMD
+#endif
+
+#define CACHE_LINE_SIZE		64
+#define REPEAT_BYTES		((size_t)4 << 30)
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void saxpy_scalar(float *y, const float *x, const float a, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		y[i] = a * x[i] + y[i];
+}
+
+#ifdef HAS_X86_SIMD
+__attribute__((target("avx2,fma")))
+static void saxpy_avx2(float *y, const float *x, const float a, const size_t n)
+{
+	const __m256 va = _mm256_set1_ps(a);
+	for (size_t i = 0; i < n; i += 8)
+		_mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+}
+
+__attribute__((target("avx512f")))
+static void saxpy_avx512(float *y, const float *x, const float a, const size_t n)
+{
+	const __m512 va = _mm512_set1_ps(a);
+	for (size_t i = 0; i < n; i += 16)
+		_mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+}
+#endif
+
+typedef void (*Kernel)(float *y, const float *x, const float a, const size_t n);
+
+// returns GB/s of loads and stores
+static double measure(const Kernel kernel, float *y, const float *x, const size_t n)
+{
+	const size_t repeats = REPEAT_BYTES / (3 * n * sizeof(float));
+	kernel(y, x, 0.5f, n);
+
+	const double start = now_ns();
+	for (size_t r = 0; r < repeats; r++)
+		kernel(y, x, 0.5f, n);
+	const double elapsed = now_ns() - start;
+	return (double)repeats * 3 * n * sizeof(float) / elapsed;
+}
+
+static void run(const char *name, const Kernel kernel)
+{
+	// L1, L2 and L3-sized working sets, split loads cost the most when data is close
+	const size_t sizes[] = { 2048, 32768, 524288 };
+	printf("%-8s", name);
+
+	for (int i = 0; i < 3; i++)
+	{
+		const size_t n = sizes[i];
+		LinearAllocator allocator;
+		la_init(&allocator, 2 * (n * sizeof(float) + 2 * CACHE_LINE_SIZE));
+
+		// room for shifting by one float
+		float *x = la_alloc_aligned(&allocator, (n + 1) * sizeof(float), CACHE_LINE_SIZE);
+		float *y = la_alloc_aligned(&allocator, (n + 1) * sizeof(float), CACHE_LINE_SIZE);
+		for (size_t j = 0; j <= n; j++)
+			x[j] = y[j] = (float)j;
+
+		const double aligned		= measure(kernel, y, x, n);
+		const double misaligned		= measure(kernel, y + 1, x + 1, n);
+		printf("  %8zu floats: %7.2f / %7.2f GB/s (%+5.1f%%)", n, aligned, misaligned, (misaligned / aligned - 1) * 100);
+
+		la_terminate(&allocator);
+	}
+	printf("\n");
+}
+
+int main(void)
+{
+	printf("saxpy throughput, 64-byte aligned / shifted by 4 bytes\n");
+	run("scalar", saxpy_scalar);
+#ifdef HAS_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		run("avx2", saxpy_avx2);
+	if (__builtin_cpu_supports("avx512f"))
+		run("avx512", saxpy_avx512);
+#endif
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Compares per-frame update of entity positions stored as structs in PoolAllocator and
+// as separate field arrays in SoaPool. update touches 6 floats of a 128-byte entity,
+// AoS loop pulls whole entities through cache, SoA loop reads only the arrays it needs.
+// second half runs after every other entity was freed: AoS skips holes, SoA stays dense.
+//
+// usage: soa_update [entities]
+#include "../include/pool_allocator.h"
+#include "../include/soa_pool.h"
+#include <stdio.h>
+#include <stdlib.h>					// atol
+#include <time.h>					// clock_gettime
+
+#define FRAMES			200
+#define DT			(1.0f / 60.0f)
+
+struct Entity
+{
+	float x, y, z;
+	float vx, vy, vz;
+	int alive;
+	int health;
+	char cold[96];					// name, flags, everything the update doesn't read
+};
+
+enum { X, Y, Z, VX, VY, VZ, HEALTH, COLD, NUM_OF_FIELDS };
+
+static const SoaField entity_fields[NUM_OF_FIELDS] =
+{
+	{ sizeof(float), sizeof(float) }, { sizeof(float), sizeof(float) }, { sizeof(float), sizeof(float) },
+	{ sizeof(float), sizeof(float) }, { sizeof(float), sizeof(float) }, { sizeof(float), sizeof(float) },
+	{ sizeof(int), sizeof(int) }, { 96, 8 }
+};
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void update_aos(PoolAllocator *pool, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		struct Entity *entity = (struct Entity *)(pool->start + i * pool->element_size);
+		if (!entity->alive)
+			continue;
+		entity->x += entity->vx * DT;
+		entity->y += entity->vy * DT;
+		entity->z += entity->vz * DT;
+	}
+}
+
+static void update_axis(float *restrict position, const float *restrict velocity, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		position[i] += velocity[i] * DT;
+}
+
+static void update_soa(SoaPool *pool)
+{
+	const size_t n = soa_count(pool);
+	update_axis(SOA_ARRAY(pool, float, X), SOA_ARRAY(pool, float, VX), n);
+	update_axis(SOA_ARRAY(pool, float, Y), SOA_ARRAY(pool, float, VY), n);
+	update_axis(SOA_ARRAY(pool, float, Z), SOA_ARRAY(pool, float, VZ), n);
+}
+
+// returns ns per live entity per frame
+static double measure_aos(PoolAllocator *pool, const size_t n, const size_t live)
+{
+	update_aos(pool, n);
+	const double start = now_ns();
+	for (int frame = 0; frame < FRAMES; frame++)
+		update_aos(pool, n);
+	return (now_ns() - start) / FRAMES / live;
+}
+
+static double measure_soa(SoaPool *pool)
+{
+	update_soa(pool);
+	const double start = now_ns();
+	for (int frame = 0; frame < FRAMES; frame++)
+		update_soa(pool);
+	return (now_ns() - start) / FRAMES / soa_count(pool);
+}
+
+int main(int argc, char **argv)
+{
+	const size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1 << 20;
+
+	PoolAllocator aos;
+	SoaPool soa;
+	pa_init(&aos, n, sizeof(struct Entity));
+	soa_init(&soa, n, entity_fields, NUM_OF_FIELDS);
+
+	struct Entity **entities = malloc(n * sizeof(struct Entity *));
+	size_t *handles = malloc(n * sizeof(size_t));
+	for (size_t i = 0; i < n; i++)
+	{
+		entities[i] = pa_alloc(&aos);
+		handles[i] = soa_alloc(&soa);
+
+		const float velocity = (float)(i % 17) - 8.0f;
+		entities[i]->x = entities[i]->y = entities[i]->z = (float)i;
+		entities[i]->vx = entities[i]->vy = entities[i]->vz = velocity;
+		entities[i]->alive = 1;
+		for (int field = X; field <= Z; field++)
+			*(float *)soa_get(&soa, handles[i], field) = (float)i;
+		for (int field = VX; field <= VZ; field++)
+			*(float *)soa_get(&soa, handles[i], field) = velocity;
+	}
+
+	printf("%zu entities of %zu bytes, %d frames\n", n, sizeof(struct Entity), FRAMES);
+	printf("all live:        AoS %6.2f ns, SoA %6.2f ns per entity\n", measure_aos(&aos, n, n), measure_soa(&soa));
+
+	// pool allocator leaves holes behind, soa pool moves last entity into them
+	for (size_t i = 0; i < n; i += 2)
+	{
+		entities[i]->alive = 0;
+		pa_free(&aos, entities[i]);
+		soa_free(&soa, handles[i]);
+	}
+	const size_t live = n - (n + 1) / 2;
+	printf("half freed:      AoS %6.2f ns, SoA %6.2f ns per entity\n", measure_aos(&aos, n, live), measure_soa(&soa));
+
+	free(handles);
+	free(entities);
+	soa_terminate(&soa);
+	pa_terminate(&aos);
+	return 0;
+}
@@ -0,0 +1,712 @@
+// Replays a recorded allocation trace against every allocator and glibc malloc.
+// Reports replay time, peak RSS and bytes wasted by the allocator,
+// a trace an allocator can't serve (out of space, non-LIFO free for stacks) is reported as failed.
+//
+// usage: trace_replay [-c capacity] [-a allocator] <trace>
+//	capacity	- bytes given to each arena or pool, 64 MiB by default
+//	allocator	- address of traced allocator, replays events of this allocator only
+//
+// TRACE FORMATS
+// binary trace written by trace_start (include/allocation_trace.h), resets of a traced allocator
+// release allocations of that allocator only. Or CSV text, one operation per line:
+//	a,<id>,<size>[,<alignment>]		allocate <size> bytes, <id> is an unsigned number naming the allocation
+//	f,<id>							free allocation <id>
+//	r								release every live allocation (end of frame, request, ...)
+// empty lines and lines starting with '#' are skipped
+#include "../include/linear_allocator.h"
+#include "../include/stack_allocator.h"
+#include "../include/pool_allocator.h"
+#include "../include/growable_pool_allocator.h"
+#include "../include/double_buffered_allocator.h"
+#include "../include/double_ended_stack_allocator.h"
+#include "../include/allocation_trace.h"	// TraceEvent, TraceFileHeader
+#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>							// malloc_usable_size
+#include <time.h>							// clock_gettime
+#include <unistd.h>							// fork, pipe
+#include <sys/resource.h>					// struct rusage
+#include <sys/wait.h>						// wait4
+
+#define DEFAULT_CAPACITY		((size_t)64 << 20)
+
+// double-ended stack puts big allocations to the front and small ones to the back
+#define DOUBLE_ENDED_FRONT_SIZE	1024
+
+typedef enum { OP_ALLOC, OP_FREE, OP_RESET } OpType;
+
+struct Op
+{
+	uint32_t type;
+	uint32_t id;				// dense allocation number
+	uint64_t size;
+	uint64_t alignment;
+};
+
+struct Trace
+{
+	struct Op *ops;
+	size_t count, capacity;
+	uint32_t allocations;
+	uint64_t max_size, max_alignment;
+};
+
+//
+// LOADING
+//
+
+// maps (source, name) of an allocation to its dense id
+struct IdMap
+{
+	uint64_t *keys;				// two words per slot
+	uint32_t *values;			// UINT32_MAX - empty slot
+	size_t capacity, count;
+};
+
+static size_t id_map_index(const struct IdMap *map, const uint64_t source, const uint64_t name)
+{
+	size_t i = (size_t)((name * 0x9E3779B97F4A7C15ULL) ^ source) & (map->capacity - 1);
+	while (map->values[i] != UINT32_MAX && (map->keys[2 * i] != source || map->keys[2 * i + 1] != name))
+		i = (i + 1) & (map->capacity - 1);
+	return i;
+}
+
+static uint32_t *id_map_find(const struct IdMap *map, const uint64_t source, const uint64_t name)
+{
+	if (map->capacity == 0)
+		return NULL;
+	const size_t i = id_map_index(map, source, name);
+	return map->values[i] == UINT32_MAX ? NULL : &map->values[i];
+}
+
+static void id_map_set(struct IdMap *map, const uint64_t source, const uint64_t name, const uint32_t value)
+{
+	if ((map->count + 1) * 2 > map->capacity)
+	{
+		struct IdMap grown = { NULL, NULL, map->capacity ? map->capacity * 2 : 1024, 0 };
+		grown.keys		= (uint64_t *)malloc(grown.capacity * 2 * sizeof(uint64_t));
+		grown.values	= (uint32_t *)malloc(grown.capacity * sizeof(uint32_t));
+		memset(grown.values, 0xFF, grown.capacity * sizeof(uint32_t));
+		for (size_t i = 0; i < map->capacity; i++)
+			if (map->values[i] != UINT32_MAX)
+				id_map_set(&grown, map->keys[2 * i], map->keys[2 * i + 1], map->values[i]);
+		free(map->keys);
+		free(map->values);
+		*map = grown;
+	}
+
+	const size_t i = id_map_index(map, source, name);
+	if (map->values[i] == UINT32_MAX)
+	{
+		map->keys[2 * i]		= source;
+		map->keys[2 * i + 1]	= name;
+		map->count++;
+	}
+	map->values[i] = value;
+}
+
+static void push_op(struct Trace *trace, const OpType type, const uint32_t id, const uint64_t size, const uint64_t alignment)
+{
+	if (trace->count == trace->capacity)
+	{
+		trace->capacity	= trace->capacity ? trace->capacity * 2 : 4096;
+		trace->ops		= (struct Op *)realloc(trace->ops, trace->capacity * sizeof(struct Op));
+	}
+	trace->ops[trace->count++] = (struct Op){ type, id, size, alignment };
+}
+
+// allocations that are alive while loading
+struct LiveSet
+{
+	uint32_t *ids;
+	uint64_t *sources;			// traced allocator of each live allocation
+	size_t count, capacity;
+	size_t *position;			// index in ids by allocation id, SIZE_MAX - freed
+	size_t position_capacity;
+};
+
+static void live_set_remove(struct LiveSet *live, const size_t index)
+{
+	live->position[live->ids[index]] = SIZE_MAX;
+	if (index != --live->count)
+	{
+		live->ids[index]				= live->ids[live->count];
+		live->sources[index]			= live->sources[live->count];
+		live->position[live->ids[index]]	= index;
+	}
+}
+
+static void load_alloc(struct Trace *trace, struct IdMap *map, struct LiveSet *live, const uint64_t source, const uint64_t name,
+					   const uint64_t size, uint64_t alignment)
+{
+	if (alignment < DEFAULT_ALIGNMENT)
+		alignment = DEFAULT_ALIGNMENT;
+
+	// the same name after free is a new allocation
+	const uint32_t id = trace->allocations++;
+	id_map_set(map, source, name, id);
+	push_op(trace, OP_ALLOC, id, size, alignment);
+
+	if (size > trace->max_size)
+		trace->max_size = size;
+	if (alignment > trace->max_alignment)
+		trace->max_alignment = alignment;
+
+	if (live->count == live->capacity)
+	{
+		live->capacity	= live->capacity ? live->capacity * 2 : 1024;
+		live->ids		= (uint32_t *)realloc(live->ids, live->capacity * sizeof(uint32_t));
+		live->sources	= (uint64_t *)realloc(live->sources, live->capacity * sizeof(uint64_t));
+	}
+	if (id >= live->position_capacity)
+	{
+		live->position_capacity	= live->position_capacity ? live->position_capacity * 2 : 1024;
+		live->position			= (size_t *)realloc(live->position, live->position_capacity * sizeof(size_t));
+	}
+	live->ids[live->count]		= id;
+	live->sources[live->count]	= source;
+	live->position[id]			= live->count++;
+}
+
+static int load_free(struct Trace *trace, struct IdMap *map, struct LiveSet *live, const uint64_t source, const uint64_t name)
+{
+	const uint32_t *id = id_map_find(map, source, name);
+	if (id == NULL || live->position[*id] == SIZE_MAX)
+		return 0;
+
+	push_op(trace, OP_FREE, *id, 0, 0);
+	live_set_remove(live, live->position[*id]);
+	return 1;
+}
+
+static void free_loading_state(struct IdMap *map, struct LiveSet *live)
+{
+	free(map->keys);
+	free(map->values);
+	free(live->ids);
+	free(live->sources);
+	free(live->position);
+}
+
+static int load_csv(FILE *file, struct Trace *trace)
+{
+	struct IdMap map = { 0 };
+	struct LiveSet live = { 0 };
+	char line[256];
+	size_t line_number = 0;
+
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		line_number++;
+		unsigned long long id, size, alignment = 0;
+
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+		else if (line[0] == 'r')
+		{
+			push_op(trace, OP_RESET, 0, 0, 0);
+			while (live.count != 0)
+				live_set_remove(&live, live.count - 1);
+		}
+		else if (sscanf(line, "a,%llu,%llu,%llu", &id, &size, &alignment) >= 2)
+		{
+			if (alignment & (alignment - 1))
+			{
+				fprintf(stderr, "line %zu: alignment is not a power of two\n", line_number);
+				free_loading_state(&map, &live);
+				return 0;
+			}
+			load_alloc(trace, &map, &live, 0, id, size, alignment);
+		}
+		else if (sscanf(line, "f,%llu", &id) == 1)
+		{
+			if (!load_free(trace, &map, &live, 0, id))
+				fprintf(stderr, "line %zu: free of unknown allocation %llu is skipped\n", line_number, id);
+		}
+		else
+		{
+			fprintf(stderr, "line %zu: unknown operation\n", line_number);
+			free_loading_state(&map, &live);
+			return 0;
+		}
+	}
+	free_loading_state(&map, &live);
+	return 1;
+}
+
+struct Record
+{
+	TraceEvent event;
+	size_t order;
+};
+
+static int compare_records(const void *a, const void *b)
+{
+	const struct Record *left = (const struct Record *)a, *right = (const struct Record *)b;
+	if (left->event.timestamp != right->event.timestamp)
+		return left->event.timestamp < right->event.timestamp ? -1 : 1;
+	return left->order < right->order ? -1 : (left->order > right->order);
+}
+
+// 0 - events of every traced allocator
+static uint64_t selected_allocator = 0;
+
+static int load_binary(FILE *file, struct Trace *trace)
+{
+	struct Record *records = NULL;
+	size_t count = 0, capacity = 0;
+	TraceEvent event;
+
+	while (fread(&event, sizeof(event), 1, file) == 1)
+	{
+		if (selected_allocator != 0 && event.allocator != selected_allocator)
+			continue;
+		if (count == capacity)
+		{
+			capacity	= capacity ? capacity * 2 : 4096;
+			records		= (struct Record *)realloc(records, capacity * sizeof(struct Record));
+		}
+		records[count].event = event;
+		records[count].order = count;
+		count++;
+	}
+	qsort(records, count, sizeof(struct Record), compare_records);
+
+	struct IdMap map = { 0 };
+	struct LiveSet live = { 0 };
+	for (size_t i = 0; i < count; i++)
+	{
+		const TraceEvent *e = &records[i].event;
+		switch (e->type)
+		{
+			case TRACE_ALLOC:
+				load_alloc(trace, &map, &live, e->allocator, e->ptr, e->size, e->alignment_log2 ? 1ULL << e->alignment_log2 : 0);
+				break;
+			case TRACE_FREE:
+				load_free(trace, &map, &live, e->allocator, e->ptr);
+				break;
+			case TRACE_RESET:
+				// becomes frees of allocations made by that allocator
+				for (size_t j = live.count; j-- > 0;)
+					if (live.sources[j] == e->allocator)
+					{
+						push_op(trace, OP_FREE, live.ids[j], 0, 0);
+						live_set_remove(&live, j);
+					}
+				break;
+		}
+	}
+	free(records);
+	free_loading_state(&map, &live);
+	return 1;
+}
+
+static int load_trace(const char *path, struct Trace *trace)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		perror(path);
+		return 0;
+	}
+
+	TraceFileHeader header;
+	int result;
+	if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == TRACE_FILE_MAGIC)
+	{
+		if (header.version != TRACE_FILE_VERSION || header.event_size != sizeof(TraceEvent))
+		{
+			fprintf(stderr, "%s: unsupported trace version\n", path);
+			result = 0;
+		}
+		else
+			result = load_binary(file, trace);
+	}
+	else
+	{
+		rewind(file);
+		result = load_csv(file, trace);
+	}
+	fclose(file);
+	return result;
+}
+
+//
+// TARGETS
+//
+
+typedef enum
+{
+	ORDER_ANY,					// frees in any order
+	ORDER_NONE,					// frees are ignored
+	ORDER_LIFO,					// only the last allocation can be freed
+	ORDER_LIFO_PER_END			// LIFO on each end of double-ended stack
+} FreeOrder;
+
+struct Target
+{
+	const char *name;
+	FreeOrder order;
+	int (*init)(const struct Trace *trace, const size_t capacity);
+	void *(*alloc)(const uint64_t size, const uint64_t alignment);
+	void (*free)(void *ptr, const uint64_t size);
+	void (*reset)(void);		// NULL - every live allocation is freed one by one
+	size_t (*used)(void);		// bytes taken from the allocator
+	void (*terminate)(void);
+};
+
+static LinearAllocator linear;
+static StackAllocator stack;
+static PoolAllocator pool;
+static GrowablePoolAllocator growable_pool;
+static DoubleBufferedAllocator double_buffered;
+static DoubleEndedStackAllocator double_ended;
+static size_t malloc_used, pool_used;
+
+static int malloc_init(const struct Trace *trace, const size_t capacity) { malloc_used = 0; return 1; }
+static void *malloc_alloc(const uint64_t size, const uint64_t alignment)
+{
+	void *ptr = (alignment <= 2 * sizeof(void *)) ? malloc(size) : aligned_alloc(alignment, ALIGNED_SIZE(size, alignment));
+	malloc_used += ptr ? malloc_usable_size(ptr) : 0;
+	return ptr;
+}
+static void malloc_free(void *ptr, const uint64_t size) { malloc_used -= malloc_usable_size(ptr); free(ptr); }
+static size_t malloc_used_space(void) { return malloc_used; }
+static void malloc_terminate(void) {}
+
+static int linear_init(const struct Trace *trace, const size_t capacity) { la_init(&linear, capacity); return linear.start != NULL; }
+static void *linear_alloc(const uint64_t size, const uint64_t alignment) { return la_alloc_aligned(&linear, size, alignment); }
+static void linear_free(void *ptr, const uint64_t size) {}
+static void linear_reset(void) { la_reset(&linear); }
+static size_t linear_used(void) { return la_used_space(&linear); }
+static void linear_terminate(void) { la_terminate(&linear); }
+
+static int stack_init(const struct Trace *trace, const size_t capacity) { sa_init(&stack, capacity); return stack.start != NULL; }
+static void *stack_alloc(const uint64_t size, const uint64_t alignment) { return sa_alloc_aligned(&stack, size, alignment); }
+static void stack_free(void *ptr, const uint64_t size) { sa_free(&stack, ptr); }
+static void stack_reset(void) { sa_reset(&stack); }
+static size_t stack_used(void) { return sa_used_space(&stack); }
+static void stack_terminate(void) { sa_terminate(&stack); }
+
+static int pool_init(const struct Trace *trace, const size_t capacity)
+{
+	const size_t element_size = ALIGNED_SIZE(trace->max_size ? trace->max_size : 1, trace->max_alignment);
+	pa_init_aligned(&pool, capacity / element_size, element_size, trace->max_alignment);
+	pool_used = 0;
+	return pool.start != NULL;
+}
+static void *pool_alloc(const uint64_t size, const uint64_t alignment)
+{
+	void *ptr = pa_alloc(&pool);
+	pool_used += ptr ? pool.element_size : 0;
+	return ptr;
+}
+static void pool_free(void *ptr, const uint64_t size) { pool_used -= pool.element_size; pa_free(&pool, ptr); }
+static void pool_reset(void) { pa_reset(&pool); pool_used = 0; }
+static size_t pool_used_space(void) { return pool_used; }
+static void pool_terminate(void) { pa_terminate(&pool); }
+
+// capacity is not needed, slabs are mapped while replaying
+static int growable_pool_init(const struct Trace *trace, const size_t capacity)
+{
+	gpa_init_aligned(&growable_pool, trace->max_size ? trace->max_size : 1, 0, 1, trace->max_alignment);
+	return 1;
+}
+static void *growable_pool_alloc(const uint64_t size, const uint64_t alignment) { return gpa_alloc(&growable_pool); }
+static void growable_pool_free(void *ptr, const uint64_t size) { gpa_free(&growable_pool, ptr); }
+static void growable_pool_reset(void) { gpa_reset(&growable_pool); }
+static size_t growable_pool_used(void) { return gpa_used_elements(&growable_pool) * growable_pool.element_size; }
+static void growable_pool_terminate(void) { gpa_terminate(&growable_pool); }
+
+// reset is the end of a frame
+static int double_buffered_init(const struct Trace *trace, const size_t capacity) { dba_init(&double_buffered, capacity / 2); return double_buffered.stack[1].start != NULL; }
+static void *double_buffered_alloc(const uint64_t size, const uint64_t alignment) { return dba_alloc_aligned(&double_buffered, size, alignment); }
+static void double_buffered_free(void *ptr, const uint64_t size) { dba_free(&double_buffered, ptr); }
+static void double_buffered_reset(void) { dba_swap_buffers(&double_buffered); dba_reset(&double_buffered); }
+static size_t double_buffered_used(void) { return dba_used_space(&double_buffered); }
+static void double_buffered_terminate(void) { dba_terminate(&double_buffered); }
+
+static int double_ended_init(const struct Trace *trace, const size_t capacity) { desa_init(&double_ended, capacity); return double_ended.start != NULL; }
+static void *double_ended_alloc(const uint64_t size, const uint64_t alignment)
+{
+	return (size >= DOUBLE_ENDED_FRONT_SIZE) ? desa_front_alloc_aligned(&double_ended, size, alignment) : desa_back_alloc_aligned(&double_ended, size, alignment);
+}
+static void double_ended_free(void *ptr, const uint64_t size)
+{
+	if (size >= DOUBLE_ENDED_FRONT_SIZE)
+		desa_front_free(&double_ended, ptr);
+	else
+		desa_back_free(&double_ended, ptr);
+}
+static void double_ended_reset(void) { desa_reset(&double_ended); }
+static size_t double_ended_used(void) { return desa_used_space(&double_ended); }
+static void double_ended_terminate(void) { desa_terminate(&double_ended); }
+
+static const struct Target targets[] =
+{
+	{ "glibc malloc", ORDER_ANY, malloc_init, malloc_alloc, malloc_free, NULL, malloc_used_space, malloc_terminate },
+	{ "LinearAllocator", ORDER_NONE, linear_init, linear_alloc, linear_free, linear_reset, linear_used, linear_terminate },
+	{ "StackAllocator", ORDER_LIFO, stack_init, stack_alloc, stack_free, stack_reset, stack_used, stack_terminate },
+	{ "PoolAllocator", ORDER_ANY, pool_init, pool_alloc, pool_free, pool_reset, pool_used_space, pool_terminate },
+	{ "GrowablePoolAllocator", ORDER_ANY, growable_pool_init, growable_pool_alloc, growable_pool_free, growable_pool_reset, growable_pool_used, growable_pool_terminate },
+	{ "DoubleBufferedAllocator", ORDER_LIFO, double_buffered_init, double_buffered_alloc, double_buffered_free, double_buffered_reset, double_buffered_used, double_buffered_terminate },
+	{ "DoubleEndedStackAllocator", ORDER_LIFO_PER_END, double_ended_init, double_ended_alloc, double_ended_free, double_ended_reset, double_ended_used, double_ended_terminate },
+};
+
+//
+// REPLAY
+//
+
+struct Result
+{
+	int ok;
+	size_t failed_op;
+	char reason[64];
+	double time_ns;
+	size_t peak_used;
+	size_t peak_requested;
+};
+
+// state shared by both passes
+struct Replay
+{
+	void **ptrs;				// by allocation id
+	uint64_t *sizes;
+	uint32_t *live;				// ids of live allocations
+	size_t *live_position;		// index in live by allocation id
+	size_t live_count;
+	uint32_t *lifo[2];			// expected free order, one stack per end
+	size_t lifo_count[2];
+};
+
+static void live_remove(struct Replay *replay, const uint32_t id)
+{
+	const size_t position = replay->live_position[id];
+	const uint32_t last = replay->live[--replay->live_count];
+	replay->live[position]			= last;
+	replay->live_position[last]		= position;
+}
+
+static void release_all(const struct Target *target, struct Replay *replay)
+{
+	if (target->reset != NULL)
+		target->reset();
+	else
+		for (size_t i = 0; i < replay->live_count; i++)
+			target->free(replay->ptrs[replay->live[i]], replay->sizes[replay->live[i]]);
+	replay->live_count		= 0;
+	replay->lifo_count[0]	= replay->lifo_count[1] = 0;
+}
+
+// checking pass: finds out whether allocator can serve the trace and how much memory it takes
+static void replay_checked(const struct Target *target, const struct Trace *trace, struct Replay *replay, struct Result *result)
+{
+	const int checks_order = (target->order == ORDER_LIFO || target->order == ORDER_LIFO_PER_END);
+	size_t requested = 0;
+
+	for (size_t i = 0; i < trace->count; i++)
+	{
+		const struct Op *op = &trace->ops[i];
+		const uint64_t size = (op->type == OP_ALLOC) ? op->size : replay->sizes[op->id];
+		const int end = (target->order == ORDER_LIFO_PER_END && size < DOUBLE_ENDED_FRONT_SIZE);
+
+		switch (op->type)
+		{
+			case OP_ALLOC:
+				replay->sizes[op->id] = op->size;
+				if ((replay->ptrs[op->id] = target->alloc(op->size, op->alignment)) == NULL)
+				{
+					result->failed_op = i;
+					snprintf(result->reason, sizeof(result->reason), "out of space, %llu bytes", (unsigned long long)op->size);
+					return;
+				}
+				replay->live_position[op->id]		= replay->live_count;
+				replay->live[replay->live_count++]	= op->id;
+				requested += op->size;
+				if (checks_order)
+					replay->lifo[end][replay->lifo_count[end]++] = op->id;
+				break;
+			case OP_FREE:
+				if (checks_order)
+				{
+					if (replay->lifo_count[end] == 0 || replay->lifo[end][replay->lifo_count[end] - 1] != op->id)
+					{
+						result->failed_op = i;
+						snprintf(result->reason, sizeof(result->reason), "free of non-top block");
+						return;
+					}
+					replay->lifo_count[end]--;
+				}
+				// linear allocator keeps freed memory until reset, it counts as wasted
+				requested -= size;
+				target->free(replay->ptrs[op->id], size);
+				live_remove(replay, op->id);
+				break;
+			case OP_RESET:
+				release_all(target, replay);
+				requested = 0;
+				break;
+		}
+
+		const size_t used = target->used();
+		if (used > result->peak_used)
+			result->peak_used = used;
+		if (requested > result->peak_requested)
+			result->peak_requested = requested;
+	}
+	result->ok = 1;
+}
+
+// timed pass: trace is known to fit, nothing is checked
+static void replay_timed(const struct Target *target, const struct Trace *trace, struct Replay *replay)
+{
+	for (size_t i = 0; i < trace->count; i++)
+	{
+		const struct Op *op = &trace->ops[i];
+		switch (op->type)
+		{
+			case OP_ALLOC:
+				replay->ptrs[op->id] = target->alloc(op->size, op->alignment);
+				replay->sizes[op->id] = op->size;
+				replay->live_position[op->id]		= replay->live_count;
+				replay->live[replay->live_count++]	= op->id;
+				break;
+			case OP_FREE:
+				target->free(replay->ptrs[op->id], replay->sizes[op->id]);
+				live_remove(replay, op->id);
+				break;
+			case OP_RESET:
+				release_all(target, replay);
+				break;
+		}
+	}
+}
+
+static double now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void run_target(const struct Target *target, const struct Trace *trace, const size_t capacity, struct Result *result)
+{
+	struct Replay replay;
+	const size_t n = trace->allocations ? trace->allocations : 1;
+	replay.ptrs				= (void **)calloc(n, sizeof(void *));
+	replay.sizes			= (uint64_t *)calloc(n, sizeof(uint64_t));
+	replay.live				= (uint32_t *)malloc(n * sizeof(uint32_t));
+	replay.live_position	= (size_t *)malloc(n * sizeof(size_t));
+	replay.lifo[0]			= (uint32_t *)malloc(n * sizeof(uint32_t));
+	replay.lifo[1]			= (uint32_t *)malloc(n * sizeof(uint32_t));
+	replay.live_count		= replay.lifo_count[0] = replay.lifo_count[1] = 0;
+
+	if (!target->init(trace, capacity))
+	{
+		snprintf(result->reason, sizeof(result->reason), "init failed");
+		return;
+	}
+
+	replay_checked(target, trace, &replay, result);
+	release_all(target, &replay);
+
+	if (result->ok)
+	{
+		const double start = now_ns();
+		replay_timed(target, trace, &replay);
+		result->time_ns = now_ns() - start;
+		release_all(target, &replay);
+	}
+	target->terminate();
+}
+
+// every target runs in its own process, so peak RSS belongs to it alone
+static int run_isolated(const struct Target *target, const struct Trace *trace, const size_t capacity, struct Result *result, long *max_rss)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return 0;
+
+	const pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(fds[0]);
+		struct Result child_result = { 0 };
+		if (target != NULL)
+			run_target(target, trace, capacity, &child_result);
+		else
+			child_result.ok = 1;
+		const ssize_t written = write(fds[1], &child_result, sizeof(child_result));
+		_exit(written == sizeof(child_result) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	const int received = (pid > 0) && read(fds[0], result, sizeof(*result)) == sizeof(*result);
+	close(fds[0]);
+
+	int status;
+	struct rusage usage;
+	if (pid > 0 && wait4(pid, &status, 0, &usage) == pid)
+		*max_rss = usage.ru_maxrss;
+	if (!received)
+		snprintf(result->reason, sizeof(result->reason), "crashed");
+	return received;
+}
+
+int main(int argc, char **argv)
+{
+	size_t capacity = DEFAULT_CAPACITY;
+	int arg = 1;
+	for (; arg + 1 < argc; arg += 2)
+	{
+		if (strcmp(argv[arg], "-c") == 0)
+			capacity = strtoull(argv[arg + 1], NULL, 0);
+		else if (strcmp(argv[arg], "-a") == 0)
+			selected_allocator = strtoull(argv[arg + 1], NULL, 16);
+		else
+			break;
+	}
+	if (arg != argc - 1 || capacity == 0)
+	{
+		fprintf(stderr, "usage: %s [-c capacity] [-a allocator] <trace>\n", argv[0]);
+		return 1;
+	}
+
+	struct Trace trace = { 0 };
+	trace.max_alignment = DEFAULT_ALIGNMENT;
+	if (!load_trace(argv[arg], &trace))
+		return 1;
+
+	printf("%zu operations, %u allocations, max size %llu, max alignment %llu, capacity %zu\n\n",
+		trace.count, trace.allocations, (unsigned long long)trace.max_size, (unsigned long long)trace.max_alignment, capacity);
+
+	// process that doesn't replay anything, RSS is reported above it
+	struct Result baseline = { 0 };
+	long baseline_rss = 0;
+	run_isolated(NULL, &trace, capacity, &baseline, &baseline_rss);
+
+	printf("%-26s %-8s %12s %10s %14s %14s %14s\n", "allocator", "status", "time (ms)", "ns/op", "peak RSS (KiB)", "peak used", "wasted");
+	int all_ok = 1;
+	for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+	{
+		struct Result result = { 0 };
+		long max_rss = 0;
+		run_isolated(&targets[i], &trace, capacity, &result, &max_rss);
+
+		if (!result.ok)
+		{
+			printf("%-26s %-8s op %zu: %s\n", targets[i].name, "FAILED", result.failed_op, result.reason);
+			all_ok = 0;
+			continue;
+		}
+		printf("%-26s %-8s %12.3f %10.1f %14ld %14zu %14zu\n", targets[i].name, "ok",
+			result.time_ns / 1e6, trace.count ? result.time_ns / trace.count : 0.0,
+			max_rss > baseline_rss ? max_rss - baseline_rss : 0, result.peak_used,
+			result.peak_used > result.peak_requested ? result.peak_used - result.peak_requested : 0);
+	}
+
+	free(trace.ops);
+	return all_ok ? 0 : 2;
+}
@@ -3,16 +3,32 @@
 
 // debug.h
 
+// benchmarks and tools are built with -DALLOCATORS_RELEASE,
+// it turns off everything that costs time on every call
+#ifndef ALLOCATORS_RELEASE
+
 // M_ASSERT, ASSERT
 #define ASSERTION_ENABLE
 
 // PRINT, PRINT_INT, PRINT_HEX
 #define DEBUG_MESSAGES
 
+// fills allocated memory zero after initialization
+#define INIT_WITH_ZERO
+
+#endif	// ALLOCATORS_RELEASE
+
 // ignores passing NULL pointer in free functions
 #define IGNORE_NULL
 
-// fills allocated memory zero after initialization
-#define INIT_WITH_ZERO
+// allocation_trace.h
+
+// compiles allocation event hooks in, recording starts with trace_start
+#define ALLOCATION_TRACING
+
+// heap_profile.h
+
+// compiles sampling heap profiler hooks in, sampling starts with heap_profile_start
+#define HEAP_PROFILING
 
 #endif	//_DEFINES_H_
@@ -0,0 +1,81 @@
+#ifndef _ALLOCATION_TRACE_H_
+#define _ALLOCATION_TRACE_H_
+#include "../debug/defines.h"			// ALLOCATION_TRACING
+#include "memory.h"				// AllocatorKind, UNLIKELY
+#include "heap_profile.h"			// heap_profile_record, heap_profile_enabled
+#include <stddef.h>				// size_t, NULL
+#include <stdint.h>				// uint64_t, uint32_t, uint16_t, uint8_t
+
+//
+// TRACE FILE FORMAT
+// TraceFileHeader followed by TraceEvent records, native byte order.
+// events of different threads are interleaved, sort them by timestamp
+//
+#define TRACE_FILE_MAGIC	0x45434152544C4C41ULL		// "ALLTRACE"
+#define TRACE_FILE_VERSION	1
+
+typedef enum
+{
+	TRACE_ALLOC,			// ptr, size and alignment of new allocation
+	TRACE_FREE,				// ptr of released allocation
+	TRACE_RESET,			// allocations in [ptr, ptr + size) are gone, all of them if ptr is 0; also emitted by terminate
+	TRACE_SWAP				// double-buffered allocator switched to stack at ptr
+} TraceEventType;
+
+typedef struct
+{
+	uint64_t magic;
+	uint32_t version;
+	uint32_t event_size;
+} TraceFileHeader;
+
+typedef struct
+{
+	uint64_t timestamp;		// nanoseconds, CLOCK_MONOTONIC
+	uint64_t allocator;		// address of allocator structure, identifies it
+	uint64_t ptr;
+	uint64_t size;
+	uint32_t thread;		// 1, 2, ... in order of first traced event
+	uint8_t type;			// TraceEventType
+	uint8_t kind;			// AllocatorKind
+	uint8_t alignment_log2;
+	uint8_t reserved;
+} TraceEvent;				// 40 bytes
+
+// events are kept in per-thread rings and written by background thread,
+// if a ring is full event is dropped and counted
+extern int trace_start	(const char *path);
+extern void trace_stop	(void);
+
+extern void trace_record(const TraceEventType type, const AllocatorKind kind, const void *allocator,
+						 const void *ptr, const size_t size, const size_t alignment);
+
+// set by trace_start and trace_stop, read atomically by hooks of every thread
+extern int trace_enabled;
+
+//
+// HOOKS
+//
+#ifdef ALLOCATION_TRACING
+	#define TRACE_HOOK(type, kind, allocator, ptr, size, alignment) \
+		if (UNLIKELY(__atomic_load_n(&trace_enabled, __ATOMIC_ACQUIRE))) trace_record(type, kind, allocator, ptr, size, alignment);
+#else
+	#define TRACE_HOOK(type, kind, allocator, ptr, size, alignment)
+#endif	// ALLOCATION_TRACING
+
+#ifdef HEAP_PROFILING
+	#define PROFILE_HOOK(type, kind, allocator, ptr, size) \
+		if (UNLIKELY(__atomic_load_n(&heap_profile_enabled, __ATOMIC_ACQUIRE))) heap_profile_record(type, kind, allocator, ptr, size);
+#else
+	#define PROFILE_HOOK(type, kind, allocator, ptr, size)
+#endif	// HEAP_PROFILING
+
+#define TRACE_EVENT(type, kind, allocator, ptr, size, alignment) \
+	do { TRACE_HOOK(type, kind, allocator, ptr, size, alignment) PROFILE_HOOK(type, kind, allocator, ptr, size) } while (0)
+
+#define TRACE_ALLOC(kind, allocator, ptr, size, alignment)	TRACE_EVENT(TRACE_ALLOC, kind, allocator, ptr, size, alignment)
+#define TRACE_FREE(kind, allocator, ptr)					TRACE_EVENT(TRACE_FREE, kind, allocator, ptr, 0, 0)
+#define TRACE_RESET(kind, allocator)						TRACE_EVENT(TRACE_RESET, kind, allocator, NULL, 0, 0)
+#define TRACE_RESET_RANGE(kind, allocator, ptr, size)		TRACE_EVENT(TRACE_RESET, kind, allocator, ptr, size, 0)
+#define TRACE_SWAP(kind, allocator, ptr)					TRACE_EVENT(TRACE_SWAP, kind, allocator, ptr, 0, 0)
+#endif	// _ALLOCATION_TRACE_H_
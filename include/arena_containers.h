@@ -0,0 +1,91 @@
+#ifndef _ARENA_CONTAINERS_H_
+#define _ARENA_CONTAINERS_H_
+#include "memory.h"					// AllocatorKind
+#include <stddef.h>					// size_t
+#include <stdint.h>					// uint64_t
+
+// containers that live as long as their arena. nothing is freed one by one:
+// a container at the top of arena grows in place, otherwise it moves to a new block
+// and the old one stays in arena until la_reset, sa_reset or sa_free_to_marker
+
+// LinearAllocator or StackAllocator
+typedef struct
+{
+	void *allocator;
+	AllocatorKind kind;
+} Arena;
+
+#define ARENA_LINEAR(allocator)		((Arena){ (allocator), ALLOCATOR_LINEAR })
+#define ARENA_STACK(allocator)		((Arena){ (allocator), ALLOCATOR_STACK })
+
+extern void *arena_alloc	(Arena arena, const size_t size, const size_t alignment);
+
+// resizes block in place if it is the last one, copies it otherwise. NULL is allocated
+extern void *arena_grow		(Arena arena, void *ptr, const size_t old_size, const size_t new_size, const size_t alignment);
+
+//
+// DYNAMIC ARRAY
+//
+typedef struct
+{
+	Arena arena;
+	char *data;
+	size_t count;
+	size_t capacity;
+	size_t element_size;
+} ArenaArray;
+
+#define ARR_AT(array, type, index)	(((type *)(array)->data)[index])
+
+extern void arr_init		(ArenaArray *array, Arena arena, const size_t element_size, const size_t capacity);
+
+// returns 0 when arena is full
+extern int arr_reserve		(ArenaArray *array, const size_t capacity);
+
+// returns new uninitialized element, NULL when arena is full
+extern void *arr_push		(ArenaArray *array);
+
+//
+// HASH MAP
+// open addressing with linear probing, uint64_t keys and values
+//
+typedef struct
+{
+	Arena arena;
+	struct MapEntry
+	{
+		uint64_t key;
+		uint64_t value;
+	} *entries;
+	uint8_t *occupied;
+	size_t count;
+	size_t capacity;				// power of two
+	unsigned shift;					// 64 - log2(capacity)
+} ArenaMap;
+
+extern void map_init		(ArenaMap *map, Arena arena, const size_t capacity);
+
+// inserts or overwrites, returns 0 when arena is full
+extern int map_put		(ArenaMap *map, const uint64_t key, const uint64_t value);
+
+// returns NULL if there is no such key
+extern uint64_t *map_get	(ArenaMap *map, const uint64_t key);
+
+//
+// STRING BUILDER
+// data is always zero-terminated
+//
+typedef struct
+{
+	Arena arena;
+	char *data;
+	size_t length;
+	size_t capacity;				// without terminating zero
+} StringBuilder;
+
+extern void sb_init		(StringBuilder *builder, Arena arena, const size_t capacity);
+
+// returns 0 when arena is full
+extern int sb_append		(StringBuilder *builder, const char *text, const size_t length);
+extern int sb_append_string	(StringBuilder *builder, const char *text);
+#endif	// _ARENA_CONTAINERS_H_
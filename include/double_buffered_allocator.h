@@ -3,21 +3,57 @@
 #include "stack_allocator.h"
 #include <stddef.h>						// size_t
 
+// longest history of frame peaks kept by adaptive mode
+#define DBA_MAX_WINDOW			256
+
 typedef struct
 {
 	unsigned int current_stack;
 	StackAllocator stack[2];
-} DoubleBufferedAllocator;				// 16 bytes
+	struct DbaAdaptive *adaptive;		// NULL - buffers keep their size
+	struct DbaCopying *copying;			// NULL - nothing survives a swap
+} DoubleBufferedAllocator;				// 24 bytes
 
 extern void dba_init			(DoubleBufferedAllocator *allocator, const size_t total_size);
+
+// both buffers are taken from 'provider' (sa_init_from), dba_terminate gives them back
+extern void dba_init_from		(DoubleBufferedAllocator *allocator, MemoryProvider *provider, const size_t total_size);
+
+// ADAPTIVE MODE
+// peak usage of every frame (allocations between swaps) is recorded over the last 'window' frames.
+// swap resets the buffer it switches to and resizes it to p99 of the window plus 'headroom_percent',
+// allocations that don't fit the buffer go to heap chunks freed with the buffer, so a frame never fails
+extern void dba_init_adaptive	(DoubleBufferedAllocator *allocator, const size_t initial_size, const size_t window, const size_t headroom_percent);
 extern void dba_terminate		(DoubleBufferedAllocator *allocator);
 extern void dba_reset			(DoubleBufferedAllocator *allocator);
 extern void *dba_alloc_aligned	(DoubleBufferedAllocator *allocator, const size_t size, const size_t alignment);
 extern void *dba_alloc			(DoubleBufferedAllocator *allocator, const size_t size);
 extern void dba_free			(DoubleBufferedAllocator *allocator, void *ptr);
 
-// switches a stack to another one
-extern void dba_swap_buffers	(DoubleBufferedAllocator *allocator);
+// switches a stack to another one. in copying mode returns number of references to objects
+// that didn't fit the new buffer, 0 otherwise
+extern size_t dba_swap_buffers	(DoubleBufferedAllocator *allocator);
+
+// COPYING MODE
+// objects reachable from roots survive swaps: swap resets the buffer it switches to and copies
+// every reachable object of the buffer it leaves there (Cheney scan), then fixes roots and fields.
+// pointers must point to the start of an object, copies get DEFAULT_ALIGNMENT.
+// forwarding address replaces block size in the header of the copied block.
+// objects that didn't fit (or were spilled in adaptive mode) stay where they are until the next swap,
+// which drops them: a swap that returns non-zero leaves roots or fields that will dangle
+
+// returns size of object in bytes
+typedef size_t (*DbaObjectSize)	(const void *object, void *context);
+
+// called by DbaObjectTrace for every pointer field of object
+typedef void (*DbaVisit)		(void **field, void *state);
+typedef void (*DbaObjectTrace)	(void *object, DbaVisit visit, void *state, void *context);
+
+extern void dba_enable_copying	(DoubleBufferedAllocator *allocator, DbaObjectSize size, DbaObjectTrace trace, void *context);
+
+// 'root' is address of a pointer variable, returns 0 on failure
+extern int dba_add_root			(DoubleBufferedAllocator *allocator, void **root);
+extern void dba_remove_root		(DoubleBufferedAllocator *allocator, void **root);
 
 //
 // FOR DEBUGGING (CURRENT SELECTED STACK)
@@ -30,6 +66,8 @@ extern void *dba_get_pointer			(DoubleBufferedAllocator *allocator);
 extern void dba_show_memory				(DoubleBufferedAllocator *allocator);
 extern const size_t dba_used_space		(DoubleBufferedAllocator *allocator);
 extern const size_t dba_remaining_space	(DoubleBufferedAllocator *allocator);
+extern const size_t dba_buffer_size		(DoubleBufferedAllocator *allocator);
+extern const size_t dba_spilled_space	(DoubleBufferedAllocator *allocator);
 extern void dba_space_info				(DoubleBufferedAllocator *allocator);
 extern void dba_show_all_info			(DoubleBufferedAllocator *allocator);
 #endif	// _DOUBLE_BUFFERED_ALLOCATOR_
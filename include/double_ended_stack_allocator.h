@@ -1,5 +1,6 @@
 #ifndef _DOUBLE_ENDED_STACK_ALLOCATOR_
 #define _DOUBLE_ENDED_STACK_ALLOCATOR_
+#include "memory_provider.h"					// MemoryProvider
 #include <stddef.h>						// size_t
 
 typedef struct
@@ -8,9 +9,13 @@ typedef struct
 	char *current_back;
 	char *start;
 	char *end;
-} DoubleEndedStackAllocator;			// 8 bytes
+	MemoryProvider *provider;			// NULL - memory is malloc'ed
+} DoubleEndedStackAllocator;			// 10 bytes
 
 extern void desa_init			(DoubleEndedStackAllocator *allocator, const size_t total_size);
+
+// takes 'total_size' bytes from 'provider' and commits them at once, desa_terminate gives them back
+extern void desa_init_from		(DoubleEndedStackAllocator *allocator, MemoryProvider *provider, const size_t total_size);
 extern void desa_terminate		(DoubleEndedStackAllocator *allocator);
 
 // FOR BOTH OF STACKS
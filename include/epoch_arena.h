@@ -0,0 +1,65 @@
+#ifndef _EPOCH_ARENA_H_
+#define _EPOCH_ARENA_H_
+#include "linear_allocator.h"				// LinearAllocator
+#include <stddef.h>					// size_t
+#include <stdint.h>					// uint64_t
+
+#define EPOCH_MAX_READERS		64
+#define EPOCH_MAX_GENERATIONS		8
+
+// reader slot, each on its own cache line
+typedef struct
+{
+	_Alignas(64) uint64_t epoch;			// epoch seen on entering, 0 - outside of critical section
+	int in_use;
+} EpochReader;
+
+// LinearAllocator generations published to concurrent readers. one writer builds data in a fresh
+// generation and publishes its root, previous generation is retired at the current epoch.
+// readers take the root inside a critical section that only stores the epoch they entered at.
+// retired generation is reset and reused once every reader in a critical section entered
+// after it was retired. a reader must not keep pointers after leaving the critical section
+typedef struct
+{
+	void *root;					// published data, NULL before first publish
+	uint64_t epoch;					// advanced by every publish, starts at 1
+	struct EpochGeneration
+	{
+		LinearAllocator allocator;
+		uint64_t retired_epoch;
+		int state;
+	} generations[EPOCH_MAX_GENERATIONS];
+	size_t num_of_generations;
+	size_t generation_size;
+	struct EpochGeneration *building;
+	struct EpochGeneration *published;
+	EpochReader readers[EPOCH_MAX_READERS];
+} EpochArena;
+
+// generations are virtual arenas of 'generation_size' bytes, created when there is no free one
+extern void ea_init			(EpochArena *arena, const size_t generation_size);
+extern void ea_terminate		(EpochArena *arena);
+
+// WRITER
+// returns empty generation to build the next version in, NULL if all generations are still read
+extern LinearAllocator *ea_begin_build	(EpochArena *arena);
+
+// makes 'root' (allocated in the building generation) visible to readers, retires the previous one
+extern void ea_publish			(EpochArena *arena, void *root);
+
+// resets retired generations no reader can see anymore, returns their number
+extern size_t ea_reclaim		(EpochArena *arena);
+
+// READERS
+// reader slot for a thread, NULL if all slots are taken
+extern EpochReader *ea_register_reader	(EpochArena *arena);
+extern void ea_unregister_reader	(EpochReader *reader);
+
+// returns published root, valid until ea_read_unlock. no locks, two stores and a fence
+extern void *ea_read_lock		(EpochArena *arena, EpochReader *reader);
+extern void ea_read_unlock		(EpochReader *reader);
+
+// FOR DEBUGGING
+extern const size_t ea_num_of_generations	(EpochArena *arena);
+extern const size_t ea_retired_generations	(EpochArena *arena);
+#endif	// _EPOCH_ARENA_H_
@@ -0,0 +1,65 @@
+#ifndef _GROWABLE_POOL_ALLOCATOR_H_
+#define _GROWABLE_POOL_ALLOCATOR_H_
+#include "memory_provider.h"				// MemoryProvider
+#include <stddef.h>					// size_t
+
+#define DEFAULT_SLAB_SIZE		((size_t)64 << 10)
+
+// link_offset of object cache: free list link is placed after the object
+#define GPA_LINK_OUTSIDE		((size_t)-1)
+
+typedef void (*ObjectHook)(void *object, void *context);
+
+// pool that maps a new slab when elements run out. slabs are aligned to their size,
+// so slab of any element is found by masking its address. allocations come from the
+// fullest slab to keep memory compact, completely empty slabs are cached up to
+// 'max_empty_slabs' and the rest go back to the OS.
+// in object cache mode objects are constructed when their slab is mapped and destroyed
+// when it's unmapped, so they stay constructed between gpa_free and gpa_alloc
+typedef struct
+{
+	struct Slab *current;				// slab allocations are taken from
+	struct Slab *partial;				// slabs with free and used elements
+	struct Slab *full;
+	struct Slab *empty;				// cached empty slabs
+	size_t element_size;
+	size_t elements_offset;				// from start of slab to first element
+	size_t elements_per_slab;
+	size_t slab_size;
+	size_t num_of_slabs;
+	size_t num_of_empty_slabs;
+	size_t max_empty_slabs;
+	size_t link_offset;				// where free element keeps address of the next one
+	ObjectHook constructor;
+	ObjectHook destructor;
+	void *context;					// passed to constructor and destructor
+	MemoryProvider *provider;			// source of slabs, NULL - they are mapped
+} GrowablePoolAllocator;				// 128 bytes
+
+// slab_size is a power of two, 0 picks DEFAULT_SLAB_SIZE or bigger slab for large elements
+extern void gpa_init		(GrowablePoolAllocator *allocator, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs);
+extern void gpa_init_aligned	(GrowablePoolAllocator *allocator, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment);
+
+// slabs are taken from 'provider' aligned to their size, so buffer and parent providers
+// lose up to a slab to padding for each of them. slab_size 0 picks it like gpa_init
+extern void gpa_init_from	(GrowablePoolAllocator *allocator, MemoryProvider *provider, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment);
+
+// object cache: link_offset is offset of a pointer-sized field that may be overwritten while
+// object is free, or GPA_LINK_OUTSIDE. objects must be freed in constructed state
+extern void gpa_init_cache	(GrowablePoolAllocator *allocator, const size_t object_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment,
+					 const size_t link_offset, ObjectHook constructor, ObjectHook destructor, void *context);
+extern void *gpa_alloc		(GrowablePoolAllocator *allocator);
+extern void gpa_free		(GrowablePoolAllocator *allocator, void *ptr);
+
+// frees every element, keeps up to max_empty_slabs slabs
+extern void gpa_reset		(GrowablePoolAllocator *allocator);
+
+// destroys cached objects together with the live ones
+extern void gpa_terminate	(GrowablePoolAllocator *allocator);
+
+// FOR DEBUGGING
+extern const size_t gpa_num_of_slabs		(GrowablePoolAllocator *allocator);
+extern const size_t gpa_used_elements		(GrowablePoolAllocator *allocator);
+extern void gpa_show_slabs			(GrowablePoolAllocator *allocator);
+extern void gpa_show_all_info			(GrowablePoolAllocator *allocator);
+#endif	// _GROWABLE_POOL_ALLOCATOR_H_
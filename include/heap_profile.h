@@ -0,0 +1,32 @@
+#ifndef _HEAP_PROFILE_H_
+#define _HEAP_PROFILE_H_
+#include "memory.h"				// AllocatorKind
+#include <stddef.h>				// size_t
+
+// sampling heap profiler fed by allocation hooks (allocation_trace.h). every thread counts
+// allocated bytes down from a random distance with mean 'sample_interval', allocation that
+// crosses zero is sampled with its call stack. samples stay while their allocation is live,
+// each stands for weight bytes, so sums estimate live memory per call site and allocator.
+// costs one predictable branch per hook while stopped
+#define DEFAULT_SAMPLE_INTERVAL		((size_t)512 << 10)
+#define HEAP_PROFILE_MAX_DEPTH		32
+
+extern void heap_profile_start		(const size_t sample_interval);
+
+// drops all samples
+extern void heap_profile_stop		(void);
+
+// folded stacks, one line per sample: "Kind@allocator;outer;...;inner bytes", lines with
+// equal stacks add up in flamegraph.pl and speedscope. returns 0 if file can't be written
+extern int heap_profile_dump		(const char *path);
+
+extern void heap_profile_record	(const int type, const AllocatorKind kind, const void *allocator,
+						 const void *ptr, const size_t size);
+
+// set by heap_profile_start and heap_profile_stop, read atomically by hooks of every thread
+extern int heap_profile_enabled;
+
+// FOR DEBUGGING
+extern const size_t heap_profile_num_of_samples	(void);
+extern const size_t heap_profile_live_bytes		(const void *allocator);
+#endif	// _HEAP_PROFILE_H_
@@ -0,0 +1,59 @@
+#ifndef _IO_BUFFER_POOL_H_
+#define _IO_BUFFER_POOL_H_
+#include "pool_allocator.h"				// PoolAllocator
+#include <stddef.h>					// size_t
+#include <sys/types.h>					// ssize_t, off_t
+
+// read buffer of the pool, data is page-aligned and buffer size is a multiple of page size,
+// so it can be used with O_DIRECT and registered as io_uring fixed buffer
+typedef struct IoBuffer
+{
+	char *data;
+	size_t length;					// bytes filled
+	size_t refs;
+	struct IoBufferPool *pool;
+} IoBuffer;
+
+// part of a buffer that holds the buffer until released, parsed records keep slices
+// instead of copies of the data
+typedef struct
+{
+	IoBuffer *buffer;
+	const char *data;
+	size_t length;
+} IoSlice;
+
+// buffers come from PoolAllocator aligned to page size, descriptors with reference counts
+// are kept apart from data. buffer goes back to the pool when its last reference is released.
+// single-threaded like PoolAllocator: slices must be released on the thread that owns the pool
+typedef struct IoBufferPool
+{
+	PoolAllocator buffers;
+	IoBuffer *descriptors;				// one per buffer, same order as in memory
+	size_t buffer_size;
+	size_t num_of_buffers;
+	size_t num_of_free_buffers;
+} IoBufferPool;
+
+// buffer_size is rounded up to page size
+extern void iop_init		(IoBufferPool *pool, const size_t num_of_buffers, const size_t buffer_size);
+extern void iop_terminate	(IoBufferPool *pool);
+
+// returns empty buffer with one reference, NULL when all buffers are in use
+extern IoBuffer *iop_acquire	(IoBufferPool *pool);
+
+// reads from 'fd' at 'offset' (or current position if offset is -1) into free space of buffer
+extern ssize_t iop_read	(IoBuffer *buffer, const int fd, const off_t offset);
+
+// each slice takes a reference to the buffer
+extern IoSlice iop_slice		(IoBuffer *buffer, const size_t offset, const size_t length);
+extern IoSlice iop_subslice		(const IoSlice *slice, const size_t offset, const size_t length);
+
+extern void iop_retain		(IoBuffer *buffer);
+extern void iop_release		(IoBuffer *buffer);
+extern void iop_release_slice	(IoSlice *slice);
+
+// FOR DEBUGGING
+extern const size_t iop_free_buffers	(IoBufferPool *pool);
+extern void iop_show_all_info		(IoBufferPool *pool);
+#endif	// _IO_BUFFER_POOL_H_
@@ -1,5 +1,7 @@
 #ifndef _LINEAR_ALLOCATOR_H_
 #define _LINEAR_ALLOCATOR_H_
+#include "memory.h"				// MemoryBacking
+#include "memory_provider.h"			// MemoryProvider
 #include <stddef.h>				// size_t
 
 typedef struct
@@ -7,17 +9,64 @@ typedef struct
 	char *current;
 	char *start;
 	char *end;
-} LinearAllocator;				// 6 bytes
+	char *committed;			// commit watermark, equals end for heap memory
+	size_t commit_chunk;
+	MemoryBacking backing;
+	int fd;					// memfd of MEMORY_SHARED_FILE arena, -1 otherwise
+	MemoryProvider *provider;		// source of MEMORY_PROVIDED arena, NULL otherwise
+} LinearAllocator;				// 8 bytes
 
 extern void la_init				(LinearAllocator *allocator, const size_t total_size);
+
+// reserves 'total_size' bytes of address space and commits them by 'commit_chunk' bytes on demand
+// (0 means DEFAULT_COMMIT_CHUNK), allocated pointers never move
+extern void la_init_virtual		(LinearAllocator *allocator, const size_t total_size, const size_t commit_chunk);
+
+// takes 'total_size' bytes from 'provider', commits them by DEFAULT_COMMIT_CHUNK bytes if the provider commits.
+// provider must outlive the arena, la_terminate gives memory back to it
+extern void la_init_from		(LinearAllocator *allocator, MemoryProvider *provider, const size_t total_size);
 extern void *la_alloc_aligned	(LinearAllocator *allocator, const size_t size, const size_t alignment);
 extern void *la_alloc			(LinearAllocator *allocator, const size_t size);
 extern void la_reset			(LinearAllocator *allocator);
+
+// grows or shrinks the last allocation in place, returns 0 if 'ptr' is not the last one or there is no space
+extern int la_resize			(LinearAllocator *allocator, void *ptr, const size_t old_size, const size_t new_size);
 extern void la_terminate		(LinearAllocator *allocator);
 
+// faults in 'size' bytes after current pointer (0 - up to the end), so allocations from them
+// take no page faults. virtual arenas commit these bytes first. returns 0 if commit failed
+extern int la_prefault			(LinearAllocator *allocator, const size_t size);
+
+// SNAPSHOTS
+// the used region is stored as is, so the arena comes back at a different address:
+// link data with RelativePointer (relative_pointer.h) or offsets from start, not with raw pointers.
+// loaded arena starts page-aligned, bigger alignments survive only if the saved arena was page-aligned too
+
+// writes [start, current) to a file, returns 0 on failure
+extern int la_save_snapshot		(LinearAllocator *allocator, const char *path);
+
+// maps a snapshot read-only or copy-on-write, arena is full after loading, returns 0 on failure
+extern int la_load_snapshot		(LinearAllocator *allocator, const char *path, const int copy_on_write);
+
+// CLONES
+// arena created with la_init_shared lives in a memfd. a clone maps the same pages copy-on-write:
+// it costs page table setup, and only pages written by either side stop being shared.
+// the source must not be written while its clones exist, clone sees source pages it hasn't copied yet.
+// clone has its own base address: use RelativePointer or offsets inside arena, or la_rebase for raw pointers
+
+// creates arena of 'total_size' bytes in a memfd, returns 0 on failure
+extern int la_init_shared		(LinearAllocator *allocator, const size_t total_size);
+
+// clone continues allocating where source stopped, terminated by la_terminate, returns 0 on failure
+extern int la_clone			(LinearAllocator *clone, const LinearAllocator *source);
+
+// translates pointer into 'from' arena to the same place in 'to' arena
+extern void *la_rebase			(const LinearAllocator *to, const LinearAllocator *from, const void *ptr);
+
 // FOR DEBUGGING
 extern const size_t la_used_space		(LinearAllocator *allocator);
 extern const size_t la_remaining_space	(LinearAllocator *allocator);
+extern const size_t la_committed_space	(LinearAllocator *allocator);
 extern void la_show_memory				(LinearAllocator *allocator);
 extern void la_show_all_info			(LinearAllocator *allocator);
 #endif // _LINEAR_ALLOCATOR_H_
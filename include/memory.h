@@ -13,4 +13,43 @@
 // calculating padding
 #define PADDING(size, alignment) ((alignment - ((size) % alignment)) % alignment)
 
+// rounding address up or down to alignment
+#define ALIGN_POINTER(ptr, alignment)       ((char *)ALIGNED_SIZE((size_t)(ptr), alignment))
+#define ALIGN_POINTER_DOWN(ptr, alignment)  ((char *)((size_t)(ptr) & ~((size_t)(alignment) - 1)))
+
+// branch hints and keeping slow paths out of line
+#if defined(__GNUC__) || defined(__clang__)
+    #define LIKELY(expr)    __builtin_expect(!!(expr), 1)
+    #define UNLIKELY(expr)  __builtin_expect(!!(expr), 0)
+    #define NOINLINE        __attribute__((noinline))
+#else
+    #define LIKELY(expr)    (expr)
+    #define UNLIKELY(expr)  (expr)
+    #define NOINLINE
+#endif
+
+// where memory of an allocator comes from
+typedef enum
+{
+    MEMORY_HEAP,                // malloc'ed block
+    MEMORY_VIRTUAL,             // reserved address space, committed on demand
+    MEMORY_MAPPED_READ_ONLY,    // file mapped with PROT_READ
+    MEMORY_MAPPED_PRIVATE,      // file mapped copy-on-write
+    MEMORY_SHARED_FILE,         // memfd mapped shared, clones map it copy-on-write
+    MEMORY_PROVIDED             // taken from MemoryProvider, committed on demand if it commits
+} MemoryBacking;
+
+// kinds of allocators, used by tools that deal with any of them
+typedef enum
+{
+    ALLOCATOR_LINEAR,
+    ALLOCATOR_STACK,
+    ALLOCATOR_POOL,
+    ALLOCATOR_DOUBLE_BUFFERED,
+    ALLOCATOR_DOUBLE_ENDED,
+    ALLOCATOR_SHARED_POOL,
+    ALLOCATOR_GROWABLE_POOL,
+    ALLOCATOR_KIND_COUNT
+} AllocatorKind;
+
 #endif	// _MEMORY_H_
@@ -0,0 +1,48 @@
+#ifndef _MEMORY_PROVIDER_H_
+#define _MEMORY_PROVIDER_H_
+#include "memory.h"					// AllocatorKind
+#include <stddef.h>					// size_t
+
+// source of backing memory for *_init_from variants of allocators. allocator reserves its whole
+// block once in init and releases it in terminate; if the provider has commit, reserved bytes are
+// unusable until committed: linear and stack arenas commit them on demand, other allocators at once.
+// providers are not thread-safe, like the allocators carved from them
+typedef struct MemoryProvider MemoryProvider;
+struct MemoryProvider
+{
+	// returns 'size' bytes aligned to 'alignment' (power of two), NULL on failure
+	void *(*reserve)	(MemoryProvider *provider, const size_t size, const size_t alignment);
+
+	// makes reserved bytes usable, returns 0 on failure. NULL - reserved memory is usable at once
+	int (*commit)		(MemoryProvider *provider, void *ptr, const size_t size);
+
+	// 'size' is the reserved size. NULL - memory goes back together with the source (buffer, parent reset)
+	void (*release)		(MemoryProvider *provider, void *ptr, const size_t size);
+
+	void *context;					// parent allocator, free for custom providers
+	char *current;					// free space of buffer provider
+	char *end;
+};
+
+// malloc or posix_memalign for bigger alignments
+extern void mp_init_malloc		(MemoryProvider *provider);
+
+// reserved address space committed on demand, alignments above page size are mapped at once
+extern void mp_init_mmap		(MemoryProvider *provider);
+
+// bumps through caller's buffer, releasing the last block gives its space back
+extern void mp_init_buffer		(MemoryProvider *provider, void *buffer, const size_t size);
+
+// children are allocated in 'parent' of 'kind': ALLOCATOR_LINEAR, ALLOCATOR_STACK, ALLOCATOR_DOUBLE_ENDED
+// (front stack) or ALLOCATOR_DOUBLE_BUFFERED (current frame). linear parent takes back memory
+// of every child in one reset, stack-like parents need children terminated in reverse order
+extern void mp_init_parent		(MemoryProvider *provider, const AllocatorKind kind, void *parent);
+
+// FOR ALLOCATORS
+// reserves and commits the whole block, NULL on failure
+extern void *mp_acquire			(MemoryProvider *provider, const size_t size, const size_t alignment);
+extern void mp_release			(MemoryProvider *provider, void *ptr, const size_t size);
+
+// slow path of arenas with committing provider, the same as vm_grow_committed
+extern char *mp_grow_committed	(MemoryProvider *provider, char *committed, const char *required, const char *end, const size_t commit_chunk);
+#endif	// _MEMORY_PROVIDER_H_
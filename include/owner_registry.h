@@ -0,0 +1,27 @@
+#ifndef _OWNER_REGISTRY_H_
+#define _OWNER_REGISTRY_H_
+#include "memory.h"					// AllocatorKind
+#include <stddef.h>					// size_t
+
+// maps address ranges to allocators that own them, so any pointer can be freed
+// without knowing where it came from. two-level page map of 4 KiB pages covers
+// 48-bit address space, leaves are mapped on first use.
+// every *_init registers memory of its allocator and *_terminate unregisters it,
+// virtual arenas register committed memory only. allocator must not be moved while registered.
+// child arenas (mp_init_parent) register ranges inside their parent's, the latest range wins lookups.
+// lookups take no lock, registering and unregistering do
+
+// registers [start, end) of 'allocator'
+extern void owner_register		(void *allocator, const AllocatorKind kind, const void *start, const void *end);
+
+// moves end of range registered at 'start', registers the range if there is none yet
+extern void owner_extend		(void *allocator, const AllocatorKind kind, const void *start, const void *end);
+extern void owner_unregister		(void *allocator, const void *start);
+
+// returns allocator that owns 'ptr' and stores its kind, NULL if memory isn't registered
+extern void *owner_lookup		(const void *ptr, AllocatorKind *kind);
+
+// frees 'ptr' with allocator it belongs to, pointers of linear arenas and spilled blocks
+// of double-buffered allocators are left until reset
+extern void alloc_free			(void *ptr);
+#endif	// _OWNER_REGISTRY_H_
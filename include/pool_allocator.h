@@ -1,5 +1,6 @@
 #ifndef _POOL_ALLOCATOR_H_
 #define _POOL_ALLOCATOR_H_
+#include "memory_provider.h"				// MemoryProvider
 #include <stddef.h>					// size_t
 
 typedef struct
@@ -11,15 +12,37 @@ typedef struct
 	char *start;
 	size_t num_of_elements;
 	size_t element_size;
-} PoolAllocator;					// 8 bytes
+	const void *owner;				// thread bound by pa_set_owner, NULL - no checks
+	MemoryProvider *provider;			// NULL - elements are malloc'ed
+
+	// elements freed by other threads, a cache line away from the owner's fields wherever the pool
+	// is placed, so remote frees don't slow down the owner. pool needs only pointer alignment
+	char padding[64];
+	struct FreeList *remote;
+} PoolAllocator;					// 120 bytes
 
 extern void pa_init		(PoolAllocator *allocator, const size_t num_of_elements, const size_t element_size);
 extern void pa_init_aligned	(PoolAllocator *allocator, const size_t num_of_elements, const size_t element_size, const size_t alignment);
+
+// elements are taken from 'provider' and committed at once, pa_terminate gives them back
+extern void pa_init_from	(PoolAllocator *allocator, MemoryProvider *provider, const size_t num_of_elements, const size_t element_size, const size_t alignment);
 extern void pa_free		(PoolAllocator *allocator, void *ptr);
 extern void *pa_alloc		(PoolAllocator *allocator);
 extern void pa_terminate	(PoolAllocator *allocator);
 extern void pa_reset		(PoolAllocator *allocator);
 
+// REMOTE FREES
+// pool bound to a thread stays single-threaded for it: owner's alloc and free don't use atomics.
+// other threads may free its elements, they are pushed to lock-free list of the pool,
+// owner takes the whole list in one exchange when its own free list runs out.
+// pa_alloc, pa_reset and pa_terminate belong to the owner only
+
+// binds pool to the calling thread
+extern void pa_set_owner	(PoolAllocator *allocator);
+
+// faults in every element, building free list faults in only pages where elements start
+extern void pa_prefault		(PoolAllocator *allocator);
+
 // FOR DEBUGGING
 extern void pa_show_memory	(PoolAllocator *allocator);
 extern void *pa_get_header	(PoolAllocator *allocator);
@@ -0,0 +1,19 @@
+#ifndef _RELATIVE_POINTER_H_
+#define _RELATIVE_POINTER_H_
+#include <stddef.h>					// ptrdiff_t, NULL
+
+// self-relative pointer: stores distance from its own address to the target,
+// so structures linked with it stay valid when the whole block is moved or mapped elsewhere.
+// 0 means NULL (a pointer can't point to itself)
+typedef ptrdiff_t RelativePointer;
+
+static inline void rp_set(RelativePointer *rp, const void *ptr)
+{
+	*rp = (ptr == NULL) ? 0 : (const char *)ptr - (const char *)rp;
+}
+
+static inline void *rp_get(const RelativePointer *rp)
+{
+	return (*rp == 0) ? NULL : (void *)((const char *)rp + *rp);
+}
+#endif	// _RELATIVE_POINTER_H_
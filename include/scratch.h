@@ -0,0 +1,31 @@
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+#include "stack_allocator.h"				// StackAllocator
+#include <stddef.h>					// size_t
+
+// every thread owns a few virtual stack arenas for temporary allocations.
+// a function that fills caller's arena asks for scratch that conflicts with none of
+// its arenas, so temporary blocks never interleave with its results
+#define SCRATCH_ARENA_COUNT		2
+#define SCRATCH_ARENA_SIZE		((size_t)64 << 20)		// reserved, committed on demand
+
+typedef struct
+{
+	StackAllocator *arena;
+	size_t marker;					// top of arena when scratch was taken
+} Scratch;
+
+// arena of calling thread that is none of 'conflicts', arena is NULL if all of them conflict
+extern Scratch scratch_begin	(StackAllocator *const *conflicts, const size_t num_of_conflicts);
+
+// frees everything allocated from scratch since scratch_begin
+extern void scratch_end		(Scratch *scratch);
+
+// scratch released when 'name' goes out of scope, arguments are conflicting arenas:
+//	SCRATCH_SCOPE(temp, output);
+//	char *buffer = sa_alloc(temp.arena, size);
+#define SCRATCH_CONFLICTS(...)		((StackAllocator *const []){ NULL, ##__VA_ARGS__ })
+#define SCRATCH_SCOPE(name, ...) \
+	__attribute__((cleanup(scratch_end))) Scratch name = scratch_begin(SCRATCH_CONFLICTS(__VA_ARGS__) + 1, \
+		sizeof(SCRATCH_CONFLICTS(__VA_ARGS__)) / sizeof(StackAllocator *) - 1)
+#endif	// _SCRATCH_H_
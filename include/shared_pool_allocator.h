@@ -0,0 +1,41 @@
+#ifndef _SHARED_POOL_ALLOCATOR_H_
+#define _SHARED_POOL_ALLOCATOR_H_
+#include <stddef.h>					// size_t
+
+// pool placed in shared memory: free list links are element indices instead of pointers,
+// so every process may map it at its own address. alloc and free are lock-free across processes.
+// records are passed between processes as offsets (spa_to_offset, spa_from_offset)
+typedef struct
+{
+	struct SharedPoolHeader *header;		// beginning of shared memory
+	char *start;					// first element
+	size_t mapped_size;
+	int fd;
+} SharedPoolAllocator;					// 16 bytes
+
+// creates shared memory with shm_open(name) or memfd_create if name is NULL, returns 0 on failure
+extern int spa_create		(SharedPoolAllocator *allocator, const char *name, const size_t num_of_elements, const size_t element_size);
+
+// maps pool created by another process, returns 0 on failure
+extern int spa_attach		(SharedPoolAllocator *allocator, const char *name);
+extern int spa_attach_fd	(SharedPoolAllocator *allocator, const int fd);
+
+// unmaps pool in this process only
+extern void spa_detach		(SharedPoolAllocator *allocator);
+
+// removes the name, memory is gone after the last process detaches
+extern void spa_unlink		(const char *name);
+
+extern void *spa_alloc		(SharedPoolAllocator *allocator);
+extern void spa_free		(SharedPoolAllocator *allocator, void *ptr);
+
+// offsets are the same in every process
+extern size_t spa_to_offset	(SharedPoolAllocator *allocator, const void *ptr);
+extern void *spa_from_offset	(SharedPoolAllocator *allocator, const size_t offset);
+
+// FOR DEBUGGING
+extern const size_t spa_element_size	(SharedPoolAllocator *allocator);
+extern const size_t spa_num_of_elements	(SharedPoolAllocator *allocator);
+extern void spa_show_memory				(SharedPoolAllocator *allocator);
+extern void spa_show_all_info			(SharedPoolAllocator *allocator);
+#endif	// _SHARED_POOL_ALLOCATOR_H_
@@ -0,0 +1,50 @@
+#ifndef _SOA_POOL_H_
+#define _SOA_POOL_H_
+#include <stddef.h>					// size_t
+
+#define SOA_MAX_FIELDS		16
+#define SOA_NO_HANDLE		((size_t)-1)
+
+// element of the pool is described field by field
+typedef struct
+{
+	size_t size;
+	size_t alignment;
+} SoaField;
+
+// pool that keeps every field of its elements in a separate array, so loop over one
+// field reads nothing else. live elements are dense: element i of every array is live
+// for i < count, free moves the last element into the hole. elements are addressed by
+// handles that stay valid while elements move, dense index of a handle changes on free
+typedef struct
+{
+	char *arrays[SOA_MAX_FIELDS];			// cache line aligned
+	size_t strides[SOA_MAX_FIELDS];
+	size_t *handle_to_index;			// free handles keep next free handle here
+	size_t *index_to_handle;
+	char *start;					// one block for arrays and both indices
+	size_t num_of_fields;
+	size_t capacity;
+	size_t count;
+	size_t free_handle;
+} SoaPool;						// 312 bytes
+
+extern void soa_init		(SoaPool *pool, const size_t capacity, const SoaField *fields, const size_t num_of_fields);
+
+// returns handle of a new zeroed element, SOA_NO_HANDLE when pool is full
+extern size_t soa_alloc		(SoaPool *pool);
+extern void soa_free		(SoaPool *pool, const size_t handle);
+extern void soa_reset		(SoaPool *pool);
+extern void soa_terminate	(SoaPool *pool);
+
+// array of 'field' for all live elements, valid until next soa_free
+#define SOA_ARRAY(pool, type, field)	((type *)(pool)->arrays[field])
+#define SOA_INDEX(pool, handle)		((pool)->handle_to_index[handle])
+
+// field of one element
+extern void *soa_get		(SoaPool *pool, const size_t handle, const size_t field);
+
+// FOR DEBUGGING
+extern const size_t soa_count		(SoaPool *pool);
+extern void soa_show_all_info		(SoaPool *pool);
+#endif	// _SOA_POOL_H_
@@ -1,5 +1,7 @@
 #ifndef _STACK_ALLOCATOR_H_
 #define _STACK_ALLOCATOR_H_
+#include "memory.h"					// MemoryBacking
+#include "memory_provider.h"				// MemoryProvider
 #include <stddef.h>					// size_t
 
 typedef struct
@@ -7,18 +9,42 @@ typedef struct
 	char *current;
 	char *start;
 	char *end;
-} StackAllocator;					// 6 bytes
+	char *committed;				// commit watermark, equals end for heap memory
+	size_t commit_chunk;
+	MemoryBacking backing;
+	MemoryProvider *provider;			// source of MEMORY_PROVIDED stack, NULL otherwise
+} StackAllocator;					// 7 bytes
 
 extern void sa_init				(StackAllocator *allocator, const size_t total_size);
+
+// reserves 'total_size' bytes of address space and commits them by 'commit_chunk' bytes on demand
+// (0 means DEFAULT_COMMIT_CHUNK), allocated pointers never move
+extern void sa_init_virtual		(StackAllocator *allocator, const size_t total_size, const size_t commit_chunk);
+
+// takes 'total_size' bytes from 'provider', commits them on demand if the provider commits.
+// provider must outlive the stack, sa_terminate gives memory back to it
+extern void sa_init_from		(StackAllocator *allocator, MemoryProvider *provider, const size_t total_size);
 extern void *sa_alloc_aligned	(StackAllocator *allocator, const size_t size, const size_t alignment);
 extern void *sa_alloc			(StackAllocator *allocator, const size_t size);
 extern void sa_free				(StackAllocator *allocator, void *ptr);
+
+// grows or shrinks the top block in place, returns 0 if 'ptr' is not the top block or there is no space
+extern int sa_resize			(StackAllocator *allocator, void *ptr, const size_t old_size, const size_t new_size);
 extern void sa_terminate		(StackAllocator *allocator);
 extern void sa_reset			(StackAllocator *allocator);
 
+// faults in 'size' bytes above the top (0 - up to the end), virtual arenas commit them first.
+// returns 0 if commit failed
+extern int sa_prefault			(StackAllocator *allocator, const size_t size);
+
+// marker is the top of the stack, freeing to it releases every block allocated after it
+extern const size_t sa_get_marker	(StackAllocator *allocator);
+extern void sa_free_to_marker	(StackAllocator *allocator, const size_t marker);
+
 // FOR DEBUGGING
 extern const size_t sa_used_space		(StackAllocator *allocator);
 extern const size_t sa_remaining_space	(StackAllocator *allocator);
+extern const size_t sa_committed_space	(StackAllocator *allocator);
 extern void sa_show_memory				(StackAllocator *allocator);
 extern void sa_space_info				(StackAllocator *allocator);
 extern void sa_show_all_info			(StackAllocator *allocator);
@@ -0,0 +1,78 @@
+#ifndef _STATIC_POOL_H_
+#define _STATIC_POOL_H_
+#include "../debug/debug.h"				// M_ASSERT, ASSERT, PRINT
+#include "allocation_trace.h"				// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include <stddef.h>					// size_t, NULL
+
+// pool of one type with storage in .bss, generated at file scope and private to the translation unit.
+// capacity and element size are constants, so index and offset math folds at compile time.
+// there is no init: slots are handed out by a bump index first, freed slots go to a free list.
+// not thread-safe, like PoolAllocator
+//	DEFINE_POOL(Connection, 4096)		-> Connection_pool_alloc, Connection_pool_free, ...
+//	DEFINE_NAMED_POOL(nodes, struct Node, 256)	-> nodes_pool_alloc, nodes_pool_free, ...
+#ifdef IGNORE_NULL
+	#define STATIC_POOL_CHECK_NULL(ptr)	if ((ptr) == NULL) return;
+#else
+	#define STATIC_POOL_CHECK_NULL(ptr)	ASSERT((ptr) != NULL);
+#endif
+
+#define DEFINE_POOL(type, capacity)		DEFINE_NAMED_POOL(type, type, capacity)
+
+#define DEFINE_NAMED_POOL(name, type, capacity)								\
+	/* free slot keeps the link, live slot the object, alignment is the bigger of the two */	\
+	union name##_PoolSlot											\
+	{													\
+		type object;											\
+		union name##_PoolSlot *next;									\
+	};													\
+														\
+	static union name##_PoolSlot name##_pool_slots[capacity];						\
+	static union name##_PoolSlot *name##_pool_freelist;							\
+	static size_t name##_pool_used;				/* slots ever handed out */		\
+														\
+	static inline type *name##_pool_alloc(void)							\
+	{													\
+		union name##_PoolSlot *slot = name##_pool_freelist;						\
+		if (slot != NULL)										\
+			name##_pool_freelist = slot->next;							\
+		else if (name##_pool_used < (capacity))							\
+			slot = &name##_pool_slots[name##_pool_used++];						\
+		else												\
+		{												\
+			PRINT("There is no available space");						\
+			return NULL;										\
+		}												\
+		TRACE_ALLOC(ALLOCATOR_POOL, name##_pool_slots, slot, sizeof(type), 0);			\
+		return &slot->object;										\
+	}													\
+														\
+	static inline void name##_pool_free(type *ptr)							\
+	{													\
+		STATIC_POOL_CHECK_NULL(ptr)									\
+		union name##_PoolSlot *slot = (union name##_PoolSlot *)ptr;					\
+		M_ASSERT(slot >= name##_pool_slots && slot < name##_pool_slots + (capacity),		\
+			"Pointer doesn't belong to the pool");							\
+		TRACE_FREE(ALLOCATOR_POOL, name##_pool_slots, ptr);						\
+		slot->next = name##_pool_freelist;								\
+		name##_pool_freelist = slot;									\
+	}													\
+														\
+	/* objects are numbered by position, indices fit into smaller handles than pointers */	\
+	static inline size_t name##_pool_index(const type *ptr)						\
+	{													\
+		return (size_t)((const union name##_PoolSlot *)ptr - name##_pool_slots);			\
+	}													\
+														\
+	static inline type *name##_pool_at(const size_t index)						\
+	{													\
+		M_ASSERT(index < (capacity), "Index is out of the pool");					\
+		return &name##_pool_slots[index].object;							\
+	}													\
+														\
+	static inline void name##_pool_reset(void)							\
+	{													\
+		TRACE_RESET(ALLOCATOR_POOL, name##_pool_slots);						\
+		name##_pool_freelist = NULL;									\
+		name##_pool_used = 0;										\
+	}
+#endif	// _STATIC_POOL_H_
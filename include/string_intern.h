@@ -0,0 +1,34 @@
+#ifndef _STRING_INTERN_H_
+#define _STRING_INTERN_H_
+#include "linear_allocator.h"				// LinearAllocator
+#include <stddef.h>					// size_t
+#include <stdint.h>					// uint32_t
+
+// keeps one zero-terminated copy of every string in a LinearAllocator, equal strings
+// get the same pointer, so they are compared with ==. strings and the index live in
+// the arena: la_reset drops the whole table, intern_init starts a new one.
+// old index is left in arena when it grows, that's less than the final index size
+typedef struct
+{
+	LinearAllocator *arena;
+	struct InternSlot
+	{
+		const char *string;			// NULL - empty slot
+		uint32_t hash;
+		uint32_t length;
+	} *slots;					// open addressing, linear probing
+	size_t count;
+	size_t capacity;				// power of two
+} InternTable;
+
+extern void intern_init		(InternTable *table, LinearAllocator *arena, const size_t capacity);
+
+// returns interned copy of 'text', NULL when arena is full
+extern const char *intern		(InternTable *table, const char *text, const size_t length);
+extern const char *intern_string	(InternTable *table, const char *text);
+
+// returns interned copy or NULL, never adds a string
+extern const char *intern_find	(InternTable *table, const char *text, const size_t length);
+
+extern uint32_t intern_hash		(const char *text, const size_t length);
+#endif	// _STRING_INTERN_H_
@@ -0,0 +1,30 @@
+#ifndef _VIRTUAL_MEMORY_H_
+#define _VIRTUAL_MEMORY_H_
+#include <stddef.h>					// size_t
+
+// amount of memory committed at once by virtual arenas if not specified
+#define DEFAULT_COMMIT_CHUNK		(64 * 1024)
+
+extern size_t vm_page_size		(void);
+
+// reserves address space without backing it with memory (PROT_NONE)
+extern void *vm_reserve			(const size_t size);
+
+// makes reserved pages readable and writable, returns 0 on failure
+extern int vm_commit			(void *ptr, const size_t size);
+
+// gives pages back to the OS, address space stays reserved
+extern void vm_decommit			(void *ptr, const size_t size);
+extern void vm_release			(void *ptr, const size_t size);
+
+// faults in pages of readable and writable memory ahead of use, so first writes don't take
+// page faults. uses MADV_POPULATE_WRITE, touches every page on kernels without it (before 5.14)
+extern void vm_prefault			(void *ptr, const size_t size);
+
+// maps readable and writable memory at address aligned to 'alignment' (power of two, multiple of page size)
+extern void *vm_map_aligned		(const size_t size, const size_t alignment);
+
+// slow path of virtual arenas: commits chunks until 'required' is below the watermark
+// returns new watermark or NULL if 'required' is beyond 'end' or commit failed
+extern char *vm_grow_committed	(char *committed, const char *required, const char *end, const size_t commit_chunk);
+#endif	// _VIRTUAL_MEMORY_H_
@@ -5,6 +5,27 @@
 #include "include/pool_allocator.h"
 #include "include/double_buffered_allocator.h"
 #include "include/double_ended_stack_allocator.h"
+#include "include/shared_pool_allocator.h"
+#include "include/growable_pool_allocator.h"
+#include "include/scratch.h"
+#include "include/arena_containers.h"
+#include "include/string_intern.h"
+#include "include/owner_registry.h"
+#include "include/soa_pool.h"
+#include "include/io_buffer_pool.h"
+#include "include/heap_profile.h"
+#include "include/epoch_arena.h"
+#include "include/static_pool.h"
+#include "include/memory_provider.h"
+#include "include/relative_pointer.h"
+#include "include/allocation_trace.h"
+
+#include <stdio.h>			// remove
+#include <stddef.h>			// offsetof
+#include <stdlib.h>			// malloc, free
+#include <unistd.h>			// pipe, write, close
+#include <sys/resource.h>		// getrusage
+#include <pthread.h>			// pthread_create, pthread_join
 
 // Uncomment to run particular test
 #define LINEAR_TEST
@@ -12,6 +33,136 @@
 #define POOL_TEST
 #define DOUBLE_BUFFERED_TEST
 #define DOUBLE_ENDED_TEST
+#define VIRTUAL_TEST
+#define SNAPSHOT_TEST
+#define SHARED_POOL_TEST
+#define TRACE_TEST
+#define ALIGNMENT_TEST
+#define GROWABLE_POOL_TEST
+#define OBJECT_CACHE_TEST
+#define SCRATCH_TEST
+#define CONTAINERS_TEST
+#define INTERN_TEST
+#define CLONE_TEST
+#define OWNER_TEST
+#define ADAPTIVE_DOUBLE_BUFFERED_TEST
+#define COPYING_DOUBLE_BUFFERED_TEST
+#define SOA_POOL_TEST
+#define IO_BUFFER_POOL_TEST
+#define PREFAULT_TEST
+#define HEAP_PROFILE_TEST
+#define REMOTE_FREE_TEST
+#define EPOCH_ARENA_TEST
+#define STATIC_POOL_TEST
+#define MEMORY_PROVIDER_TEST
+
+#ifdef OBJECT_CACHE_TEST
+struct Connection
+{
+	char *buffer;				// expensive part, kept between uses
+	struct Connection *next;		// free list link lives here while cached
+	int id;
+};
+
+static void connection_construct(void *object, void *context)
+{
+	((struct Connection *)object)->buffer = malloc(256);
+	(*(int *)context)++;
+}
+
+static void connection_destruct(void *object, void *context)
+{
+	free(((struct Connection *)object)->buffer);
+	(*(int *)context)--;
+}
+#endif	// OBJECT_CACHE_TEST
+
+#ifdef SCRATCH_TEST
+// leaf function: temporary buffer without any allocator parameter
+static size_t count_digits(const char *text)
+{
+	SCRATCH_SCOPE(temp);
+	char *digits = sa_alloc(temp.arena, 64);
+	size_t count = 0;
+	for (; *text; text++)
+		if (*text >= '0' && *text <= '9')
+			digits[count++] = *text;
+	return count;
+}
+
+// result goes to 'output', which may itself be a scratch arena of the caller
+static char *join_digits(StackAllocator *output, const char *first, const char *second)
+{
+	SCRATCH_SCOPE(temp, output);
+	size_t *lengths = sa_alloc(temp.arena, 2 * sizeof(size_t));
+	lengths[0] = count_digits(first);
+	lengths[1] = count_digits(second);
+
+	char *result = sa_alloc(output, lengths[0] + lengths[1] + 1);
+	size_t length = 0;
+	for (const char *text = first; *text; text++)
+		if (*text >= '0' && *text <= '9')
+			result[length++] = *text;
+	for (const char *text = second; *text; text++)
+		if (*text >= '0' && *text <= '9')
+			result[length++] = *text;
+	result[length] = '\0';
+	return result;
+}
+#endif	// SCRATCH_TEST
+
+#ifdef COPYING_DOUBLE_BUFFERED_TEST
+struct Entity
+{
+	struct Entity *target;
+	int health;
+};
+
+static size_t entity_size(const void *object, void *context)
+{
+	return sizeof(struct Entity);
+}
+
+static void entity_trace(void *object, DbaVisit visit, void *state, void *context)
+{
+	visit((void **)&((struct Entity *)object)->target, state);
+}
+#endif	// COPYING_DOUBLE_BUFFERED_TEST
+
+#ifdef HEAP_PROFILE_TEST
+// call sites that show up in the profile, external so -rdynamic gives them names
+void load_meshes(LinearAllocator *level)
+{
+	for (int i = 0; i < 192; i++)
+		la_alloc(level, 1024);
+}
+
+void load_sounds(LinearAllocator *level)
+{
+	for (int i = 0; i < 64; i++)
+		la_alloc(level, 1024);
+}
+#endif	// HEAP_PROFILE_TEST
+
+#ifdef REMOTE_FREE_TEST
+// worker thread is done with objects of the I/O thread's pool
+static void *release_requests(void *requests)
+{
+	for (int i = 0; i < 3; i++)
+		pa_free(((void **)requests)[0], ((void **)requests)[i + 1]);
+	return NULL;
+}
+#endif	// REMOTE_FREE_TEST
+
+#ifdef STATIC_POOL_TEST
+typedef struct
+{
+	float position[3];
+	float lifetime;
+} Particle;
+
+DEFINE_POOL(Particle, 1024)
+#endif	// STATIC_POOL_TEST
 
 int main(void)
 {
@@ -346,5 +497,891 @@ int main(void)
 		PRINT("[DOUBLE-ENDED STACK ALLOCATOR TERMINATED]");
 	}
 #endif	// DOUBLE_ENDED_TEST
+
+	//
+	// VIRTUAL MEMORY ARENAS
+	//
+#ifdef VIRTUAL_TEST
+	{
+		LinearAllocator allocator;
+
+		// 64 GiB of address space, nothing is committed yet
+		const size_t total_size = (size_t)64 << 30;
+
+		PRINT("[VIRTUAL LINEAR ALLOCATOR INITIALIZED]");
+		la_init_virtual(&allocator, total_size, 0);
+		PRINT_UINT(la_committed_space(&allocator));
+
+		PRINT("[SMALL ALLOCATION]");
+		int *array = la_alloc(&allocator, 100 * sizeof(*array));
+		if (array != NULL)
+		{
+			for (int i = 0; i < 100; i++)
+				array[i] = i;
+			PRINT_UINT(la_used_space(&allocator));
+			PRINT_UINT(la_committed_space(&allocator));
+		}
+
+		// pointer of the first allocation stays valid
+		PRINT("[BIG ALLOCATION]");
+		const size_t n = 1 << 20;
+		char *array2 = la_alloc(&allocator, n);
+		if (array2 != NULL)
+		{
+			array2[n - 1] = 0x7;
+			PRINT_UINT(la_used_space(&allocator));
+			PRINT_UINT(la_committed_space(&allocator));
+		}
+
+		PRINT("[RESETTING]");
+		la_reset(&allocator);
+		PRINT_UINT(la_used_space(&allocator));
+
+		la_terminate(&allocator);
+		PRINT("[VIRTUAL LINEAR ALLOCATOR TERMINATED]");
+
+		StackAllocator stack;
+
+		PRINT("[VIRTUAL STACK ALLOCATOR INITIALIZED]");
+		sa_init_virtual(&stack, total_size, 4096);
+		double *array3 = sa_alloc(&stack, 1000 * sizeof(*array3));
+		sa_space_info(&stack);
+		PRINT_UINT(sa_committed_space(&stack));
+		sa_free(&stack, array3);
+		sa_space_info(&stack);
+
+		sa_terminate(&stack);
+		PRINT("[VIRTUAL STACK ALLOCATOR TERMINATED]");
+	}
+#endif	// VIRTUAL_TEST
+
+	//
+	// ARENA SNAPSHOTS
+	//
+#ifdef SNAPSHOT_TEST
+	{
+		LinearAllocator allocator;
+		const char *path = "linear_allocator.snapshot";
+
+		struct Node
+		{
+			RelativePointer next;
+			int value;
+		} *head = NULL;
+
+		PRINT("[BUILDING LIST]");
+		la_init(&allocator, 16 * sizeof(struct Node));
+		for (int i = 0; i < 5; i++)
+		{
+			struct Node *node = la_alloc(&allocator, sizeof(*node));
+			node->value = i;
+			rp_set(&node->next, head);
+			head = node;
+		}
+		PRINT_UINT(la_used_space(&allocator));
+
+		// head is the last allocation, remember its offset
+		const size_t head_offset = (size_t)((char *)head - allocator.start);
+
+		PRINT("[SAVING SNAPSHOT]");
+		la_save_snapshot(&allocator, path);
+		la_terminate(&allocator);
+
+		PRINT("[LOADING SNAPSHOT]");
+		if (la_load_snapshot(&allocator, path, 0))
+		{
+			for (struct Node *node = (struct Node *)(allocator.start + head_offset); node != NULL; node = rp_get(&node->next))
+				PRINT_UINT(node->value);
+			la_terminate(&allocator);
+		}
+		remove(path);
+		PRINT("[SNAPSHOT TERMINATED]");
+	}
+#endif	// SNAPSHOT_TEST
+
+	//
+	// SHARED POOL ALLOCATOR
+	//
+#ifdef SHARED_POOL_TEST
+	{
+		// second handle plays the role of another process
+		SharedPoolAllocator producer, consumer;
+		const char *name = "/custom_allocators_shared_pool";
+
+		struct Record
+		{
+			int id;
+			char tag[4];
+		};
+
+		PRINT("[SHARED POOL ALLOCATOR CREATED]");
+		spa_unlink(name);
+		if (spa_create(&producer, name, 4, sizeof(struct Record)) && spa_attach(&consumer, name))
+		{
+			PRINT("[ALLOCATION IN PRODUCER]");
+			struct Record *record = spa_alloc(&producer);
+			record->id = 0x42;
+			record->tag[0] = 'R';
+			const size_t offset = spa_to_offset(&producer, record);
+			PRINT_UINT(offset);
+
+			// only offset crosses the process border
+			PRINT("[READING IN CONSUMER]");
+			struct Record *received = spa_from_offset(&consumer, offset);
+			PRINT_HEX(received->id);
+
+			PRINT("[DEALLOCATION IN CONSUMER]");
+			spa_free(&consumer, received);
+			spa_show_all_info(&producer);
+
+			spa_detach(&consumer);
+			spa_detach(&producer);
+		}
+		spa_unlink(name);
+		PRINT("[SHARED POOL ALLOCATOR DESTROYED]");
+	}
+#endif	// SHARED_POOL_TEST
+
+	//
+	// ALLOCATION TRACING
+	// analyze the result with ./trace_analyzer allocations.trace
+	//
+#ifdef TRACE_TEST
+	{
+		StackAllocator stack;
+		PoolAllocator pool;
+
+		PRINT("[TRACING STARTED]");
+		sa_init(&stack, 1024);
+		pa_init(&pool, 16, 32);
+		trace_start("allocations.trace");
+
+		for (int frame = 0; frame < 8; frame++)
+		{
+			void *objects[4];
+			for (int i = 0; i < 4; i++)
+				objects[i] = pa_alloc(&pool);
+
+			char *scratch = sa_alloc(&stack, 16 << (frame % 4));
+			sa_free(&stack, scratch);
+
+			for (int i = 0; i < 4; i++)
+				pa_free(&pool, objects[i]);
+		}
+		sa_reset(&stack);
+
+		trace_stop();
+		pa_terminate(&pool);
+		sa_terminate(&stack);
+		PRINT("[TRACING STOPPED]");
+	}
+#endif	// TRACE_TEST
+
+	//
+	// ALIGNED ALLOCATIONS
+	// returned addresses are aligned, not only sizes
+	//
+#ifdef ALIGNMENT_TEST
+	{
+		const size_t alignments[] = { 16, 64, 4096 };
+
+		LinearAllocator linear;
+		StackAllocator stack;
+		DoubleEndedStackAllocator double_ended;
+
+		PRINT("[ALIGNED ALLOCATIONS]");
+		la_init(&linear, 16384);
+		sa_init(&stack, 16384);
+		desa_init(&double_ended, 16384);
+
+		// one odd-sized allocation to knock current pointers off alignment
+		la_alloc(&linear, 3);
+		char *odd = sa_alloc(&stack, 3);
+		char *odd_front = desa_front_alloc(&double_ended, 3);
+		char *odd_back = desa_back_alloc(&double_ended, 3);
+
+		for (int i = 0; i < 3; i++)
+		{
+			const size_t alignment = alignments[i];
+			void *ptr = la_alloc_aligned(&linear, 10, alignment);
+			M_ASSERT(((size_t)ptr & (alignment - 1)) == 0, "LinearAllocator pointer is not aligned");
+
+			ptr = sa_alloc_aligned(&stack, 10, alignment);
+			M_ASSERT(((size_t)ptr & (alignment - 1)) == 0, "StackAllocator pointer is not aligned");
+			sa_free(&stack, ptr);
+
+			ptr = desa_front_alloc_aligned(&double_ended, 10, alignment);
+			M_ASSERT(((size_t)ptr & (alignment - 1)) == 0, "DoubleEndedStackAllocator front pointer is not aligned");
+			desa_front_free(&double_ended, ptr);
+
+			ptr = desa_back_alloc_aligned(&double_ended, 10, alignment);
+			M_ASSERT(((size_t)ptr & (alignment - 1)) == 0, "DoubleEndedStackAllocator back pointer is not aligned");
+			desa_back_free(&double_ended, ptr);
+
+			PRINT_UINT(alignment);
+		}
+		PRINT_UINT(la_used_space(&linear));
+
+		// padding is given back together with the blocks
+		sa_free(&stack, odd);
+		desa_front_free(&double_ended, odd_front);
+		desa_back_free(&double_ended, odd_back);
+		sa_space_info(&stack);
+		desa_space_info(&double_ended);
+
+		PoolAllocator pool;
+		pa_init_aligned(&pool, 4, 100, 64);
+		for (int i = 0; i < 4; i++)
+		{
+			void *ptr = pa_alloc(&pool);
+			M_ASSERT(((size_t)ptr & 63) == 0, "PoolAllocator element is not aligned");
+		}
+		pa_terminate(&pool);
+
+		desa_terminate(&double_ended);
+		sa_terminate(&stack);
+		la_terminate(&linear);
+		PRINT("[ALIGNED ALLOCATIONS DONE]");
+	}
+#endif	// ALIGNMENT_TEST
+
+	//
+	// GROWABLE POOL ALLOCATOR
+	//
+#ifdef GROWABLE_POOL_TEST
+	{
+		GrowablePoolAllocator allocator;
+		void *elements[600];
+
+		// 4 KiB slabs of 48-byte elements, one empty slab is kept
+		gpa_init(&allocator, 48, 4096, 1);
+		PRINT("[GROWABLE POOL ALLOCATOR CREATED]");
+		PRINT_UINT(allocator.elements_per_slab);
+
+		PRINT("[ALLOCATION BEYOND ONE SLAB]");
+		for (int i = 0; i < 600; i++)
+			elements[i] = gpa_alloc(&allocator);
+		gpa_show_all_info(&allocator);
+
+		// every other element: slabs become partial, nothing is released
+		PRINT("[SCATTERED DEALLOCATION]");
+		for (int i = 0; i < 600; i += 2)
+			gpa_free(&allocator, elements[i]);
+		gpa_show_all_info(&allocator);
+
+		// empty slabs: one is cached, the rest is unmapped
+		PRINT("[DEALLOCATION OF THE REST]");
+		for (int i = 1; i < 600; i += 2)
+			gpa_free(&allocator, elements[i]);
+		gpa_show_all_info(&allocator);
+
+		PRINT("[REUSE]");
+		for (int i = 0; i < 100; i++)
+			elements[i] = gpa_alloc(&allocator);
+		gpa_show_all_info(&allocator);
+
+		gpa_terminate(&allocator);
+		PRINT("[GROWABLE POOL ALLOCATOR DESTROYED]");
+	}
+#endif	// GROWABLE_POOL_TEST
+
+	//
+	// OBJECT CACHE
+	// objects are constructed once per slab, not once per allocation
+	//
+#ifdef OBJECT_CACHE_TEST
+	{
+		GrowablePoolAllocator cache;
+		int constructed = 0;
+		gpa_init_cache(&cache, sizeof(struct Connection), 4096, 0, DEFAULT_ALIGNMENT,
+			offsetof(struct Connection, next), connection_construct, connection_destruct, &constructed);
+		PRINT("[OBJECT CACHE CREATED]");
+
+		struct Connection *connection = gpa_alloc(&cache);
+		char *buffer = connection->buffer;
+		PRINT_UINT(constructed);
+
+		// freed object comes back still constructed
+		PRINT("[REALLOCATION]");
+		gpa_free(&cache, connection);
+		connection = gpa_alloc(&cache);
+		M_ASSERT(connection->buffer == buffer, "Object was constructed again");
+		PRINT_UINT(constructed);
+
+		// no empty slabs are cached, the only slab is current and stays
+		gpa_free(&cache, connection);
+		gpa_terminate(&cache);
+		PRINT_UINT(constructed);
+		PRINT("[OBJECT CACHE DESTROYED]");
+	}
+#endif	// OBJECT_CACHE_TEST
+
+	//
+	// SCRATCH ARENAS
+	//
+#ifdef SCRATCH_TEST
+	{
+		PRINT("[SCRATCH ARENAS]");
+		SCRATCH_SCOPE(outer);
+		const size_t marker = sa_get_marker(outer.arena);
+
+		// callee gets the other arena, its temporaries don't land between result bytes
+		char *joined = join_digits(outer.arena, "a1b2", "c3d4");
+		PRINT(joined);
+		PRINT_UINT(sa_used_space(outer.arena) - marker);
+
+		// with both arenas of this thread taken there is no scratch left
+		SCRATCH_SCOPE(inner, outer.arena);
+		SCRATCH_SCOPE(none, outer.arena, inner.arena);
+		PRINT_HEX(none.arena);
+		PRINT("[SCRATCH ARENAS DONE]");
+	}
+#endif	// SCRATCH_TEST
+
+	//
+	// ARENA CONTAINERS
+	//
+#ifdef CONTAINERS_TEST
+	{
+		LinearAllocator allocator;
+		la_init(&allocator, 4096);
+		PRINT("[ARENA CONTAINERS]");
+
+		// array is the last block, so it grows without copying
+		ArenaArray array;
+		arr_init(&array, ARENA_LINEAR(&allocator), sizeof(int), 4);
+		char *first_data = array.data;
+		for (int i = 0; i < 100; i++)
+			*(int *)arr_push(&array) = i;
+		M_ASSERT(array.data == first_data, "Array was moved");
+		PRINT_UINT(ARR_AT(&array, int, 99));
+		PRINT_UINT(la_used_space(&allocator));
+
+		ArenaMap map;
+		map_init(&map, ARENA_LINEAR(&allocator), 0);
+		for (uint64_t key = 1; key <= 20; key++)
+			map_put(&map, key * 1000, key);
+		PRINT_UINT(*map_get(&map, 7000));
+		PRINT_HEX(map_get(&map, 7001));
+
+		StringBuilder builder;
+		sb_init(&builder, ARENA_LINEAR(&allocator), 0);
+		sb_append_string(&builder, "grown ");
+		sb_append_string(&builder, "in place");
+		PRINT(builder.data);
+		PRINT_UINT(la_used_space(&allocator));
+
+		// the whole set goes away at once
+		la_terminate(&allocator);
+		PRINT("[ARENA CONTAINERS DONE]");
+	}
+#endif	// CONTAINERS_TEST
+
+	//
+	// STRING INTERNING
+	//
+#ifdef INTERN_TEST
+	{
+		const char *headers[] = { "Content-Type", "Host", "Content-Type", "Accept", "Host", "Content-Type" };
+
+		LinearAllocator allocator;
+		InternTable table;
+		la_init(&allocator, 4096);
+		intern_init(&table, &allocator, 0);
+		PRINT("[STRING INTERNING]");
+
+		const char *interned[6];
+		for (int i = 0; i < 6; i++)
+			interned[i] = intern_string(&table, headers[i]);
+
+		// same text, same pointer
+		M_ASSERT(interned[0] == interned[2] && interned[2] == interned[5], "Duplicate was stored twice");
+		M_ASSERT(interned[1] != interned[3], "Different strings share pointer");
+		PRINT_UINT(table.count);
+		PRINT_HEX(intern_find(&table, "Cookie", 6));
+
+		// strings and index go away together
+		la_reset(&allocator);
+		intern_init(&table, &allocator, 0);
+		PRINT_UINT(table.count);
+
+		la_terminate(&allocator);
+		PRINT("[STRING INTERNING DONE]");
+	}
+#endif	// INTERN_TEST
+
+	//
+	// ARENA CLONES
+	//
+#ifdef CLONE_TEST
+	{
+		struct Node
+		{
+			int value;
+			RelativePointer next;
+		};
+
+		LinearAllocator source, clone;
+		PRINT("[SHARED LINEAR ALLOCATOR CREATED]");
+		if (la_init_shared(&source, 1 << 20))
+		{
+			struct Node *head = la_alloc(&source, sizeof(struct Node));
+			struct Node *tail = la_alloc(&source, sizeof(struct Node));
+			head->value = 1;
+			tail->value = 2;
+			rp_set(&head->next, tail);
+			rp_set(&tail->next, NULL);
+
+			// source is frozen from now on
+			PRINT("[CLONE]");
+			la_clone(&clone, &source);
+			struct Node *clone_head = la_rebase(&clone, &source, head);
+			struct Node *clone_tail = rp_get(&clone_head->next);
+			clone_tail->value = 20;
+
+			// clone keeps allocating after the source's data
+			struct Node *extra = la_alloc(&clone, sizeof(struct Node));
+			extra->value = 30;
+			rp_set(&clone_tail->next, extra);
+
+			PRINT_UINT(clone_tail->value);
+			PRINT_UINT(tail->value);
+			PRINT_UINT(la_used_space(&clone));
+			PRINT_UINT(la_used_space(&source));
+
+			la_terminate(&clone);
+			la_terminate(&source);
+		}
+		PRINT("[SHARED LINEAR ALLOCATOR DESTROYED]");
+	}
+#endif	// CLONE_TEST
+
+	//
+	// FREEING WITHOUT KNOWING THE ALLOCATOR
+	//
+#ifdef OWNER_TEST
+	{
+		PoolAllocator pool;
+		StackAllocator stack;
+		DoubleEndedStackAllocator double_ended;
+		GrowablePoolAllocator growable_pool;
+
+		pa_init(&pool, 4, 32);
+		sa_init_virtual(&stack, (size_t)1 << 30, 0);
+		desa_init(&double_ended, 256);
+		gpa_init(&growable_pool, 24, 0, 0);
+		PRINT("[OWNER REGISTRY]");
+
+		void *pointers[] =
+		{
+			pa_alloc(&pool),
+			sa_alloc(&stack, 100),
+			desa_front_alloc(&double_ended, 16),
+			desa_back_alloc(&double_ended, 16),
+			gpa_alloc(&growable_pool)
+		};
+
+		AllocatorKind kind;
+		for (int i = 0; i < 5; i++)
+		{
+			void *owner = owner_lookup(pointers[i], &kind);
+			PRINT_HEX(owner);
+			PRINT_UINT(kind);
+		}
+
+		// reverse order keeps both stacks happy
+		for (int i = 4; i >= 0; i--)
+			alloc_free(pointers[i]);
+		PRINT_UINT(sa_used_space(&stack));
+		PRINT_UINT(desa_used_space(&double_ended));
+		PRINT_UINT(gpa_used_elements(&growable_pool));
+
+		gpa_terminate(&growable_pool);
+		desa_terminate(&double_ended);
+		sa_terminate(&stack);
+		pa_terminate(&pool);
+		PRINT_HEX(owner_lookup(pointers[0], &kind));
+		PRINT("[OWNER REGISTRY DONE]");
+	}
+#endif	// OWNER_TEST
+
+	//
+	// ADAPTIVE DOUBLE-BUFFERED ALLOCATOR
+	//
+#ifdef ADAPTIVE_DOUBLE_BUFFERED_TEST
+	{
+		DoubleBufferedAllocator allocator;
+
+		// starts oversized, learns from the last 16 frames, keeps 25% on top
+		dba_init_adaptive(&allocator, (size_t)1 << 20, 16, 25);
+		PRINT("[ADAPTIVE DOUBLE-BUFFERED ALLOCATOR CREATED]");
+
+		for (int frame = 0; frame < 40; frame++)
+		{
+			// steady 8 KiB frames with one spike of 200 KiB
+			const size_t frame_size = (frame == 30) ? 200 << 10 : 8 << 10;
+			for (size_t allocated = 0; allocated < frame_size; allocated += 1024)
+			{
+				void *block = dba_alloc(&allocator, 1024);
+				M_ASSERT(block != NULL, "Frame allocation failed");
+			}
+
+			if (frame == 1 || frame == 30 || frame == 39)
+			{
+				PRINT_UINT(frame);
+				PRINT_UINT(dba_buffer_size(&allocator));
+				PRINT_UINT(dba_spilled_space(&allocator));
+			}
+			dba_swap_buffers(&allocator);
+		}
+
+		dba_terminate(&allocator);
+		PRINT("[ADAPTIVE DOUBLE-BUFFERED ALLOCATOR DESTROYED]");
+	}
+#endif	// ADAPTIVE_DOUBLE_BUFFERED_TEST
+
+	//
+	// COPYING DOUBLE-BUFFERED ALLOCATOR
+	//
+#ifdef COPYING_DOUBLE_BUFFERED_TEST
+	{
+		DoubleBufferedAllocator allocator;
+		dba_init(&allocator, 1024);
+		dba_enable_copying(&allocator, entity_size, entity_trace, NULL);
+		PRINT("[COPYING DOUBLE-BUFFERED ALLOCATOR CREATED]");
+
+		// player and the enemy it targets survive, everything else is per-frame garbage
+		struct Entity *player = dba_alloc(&allocator, sizeof(struct Entity));
+		struct Entity *enemy = dba_alloc(&allocator, sizeof(struct Entity));
+		player->target = enemy;
+		player->health = 100;
+		enemy->target = player;
+		enemy->health = 50;
+		dba_add_root(&allocator, (void **)&player);
+
+		for (int frame = 0; frame < 3; frame++)
+		{
+			for (int i = 0; i < 10; i++)
+				dba_alloc(&allocator, 32);
+			const size_t dropped = dba_swap_buffers(&allocator);
+			M_ASSERT(dropped == 0, "Survivors were dropped");
+
+			// two entities are carried, cycle included
+			PRINT_UINT(dba_used_space(&allocator));
+			M_ASSERT(player->target->target == player, "Cycle was broken");
+			PRINT_UINT(player->target->health);
+		}
+
+		dba_remove_root(&allocator, (void **)&player);
+		dba_terminate(&allocator);
+		PRINT("[COPYING DOUBLE-BUFFERED ALLOCATOR DESTROYED]");
+	}
+#endif	// COPYING_DOUBLE_BUFFERED_TEST
+
+	//
+	// SOA POOL
+	//
+#ifdef SOA_POOL_TEST
+	{
+		enum { POSITION, VELOCITY, NAME };
+		const SoaField fields[] = { { sizeof(float), sizeof(float) }, { sizeof(float), sizeof(float) }, { 16, 1 } };
+
+		SoaPool pool;
+		soa_init(&pool, 8, fields, 3);
+		PRINT("[SOA POOL CREATED]");
+
+		size_t handles[5];
+		for (int i = 0; i < 5; i++)
+		{
+			handles[i] = soa_alloc(&pool);
+			*(float *)soa_get(&pool, handles[i], POSITION) = (float)i;
+			*(float *)soa_get(&pool, handles[i], VELOCITY) = 1.0f;
+		}
+
+		// last element moves into the hole, its handle still finds it
+		soa_free(&pool, handles[1]);
+		PRINT_UINT(soa_count(&pool));
+		PRINT_UINT(SOA_INDEX(&pool, handles[4]));
+
+		// one field of all elements is a plain array
+		float *position = SOA_ARRAY(&pool, float, POSITION);
+		const float *velocity = SOA_ARRAY(&pool, float, VELOCITY);
+		for (size_t i = 0; i < soa_count(&pool); i++)
+			position[i] += velocity[i];
+		M_ASSERT(*(float *)soa_get(&pool, handles[4], POSITION) == 5.0f, "Moved element lost its value");
+
+		soa_show_all_info(&pool);
+		soa_terminate(&pool);
+		PRINT("[SOA POOL DESTROYED]");
+	}
+#endif	// SOA_POOL_TEST
+
+	//
+	// I/O BUFFER POOL
+	//
+#ifdef IO_BUFFER_POOL_TEST
+	{
+		IoBufferPool pool;
+		iop_init(&pool, 2, 100);
+		PRINT("[I/O BUFFER POOL CREATED]");
+		iop_show_all_info(&pool);
+
+		int fds[2];
+		M_ASSERT(pipe(fds) == 0, "Can't create pipe");
+		const char request[] = "GET /index.html HTTP/1.1";
+		M_ASSERT(write(fds[1], request, sizeof(request) - 1) == sizeof(request) - 1, "Can't write to pipe");
+		close(fds[1]);
+
+		IoBuffer *buffer = iop_acquire(&pool);
+		iop_read(buffer, fds[0], -1);
+		close(fds[0]);
+		PRINT_UINT(buffer->length);
+
+		// parsed request points into the buffer, reader drops it right away
+		IoSlice line = iop_slice(buffer, 0, buffer->length);
+		IoSlice method = iop_subslice(&line, 0, 3);
+		IoSlice path = iop_subslice(&line, 4, 11);
+		iop_release(buffer);
+		iop_release_slice(&line);
+		PRINT_UINT(iop_free_buffers(&pool));
+		M_ASSERT(method.data[0] == 'G' && path.data[0] == '/', "Slices point to wrong bytes");
+		const size_t path_offset = path.data - buffer->data;
+		PRINT_UINT(path_offset);
+
+		// last slice gives the buffer back
+		iop_release_slice(&method);
+		iop_release_slice(&path);
+		PRINT_UINT(iop_free_buffers(&pool));
+
+		iop_terminate(&pool);
+		PRINT("[I/O BUFFER POOL DESTROYED]");
+	}
+#endif	// IO_BUFFER_POOL_TEST
+
+	//
+	// PREFAULTING
+	//
+#ifdef PREFAULT_TEST
+	{
+		LinearAllocator allocator;
+		la_init_virtual(&allocator, (size_t)1 << 30, 0);
+		PRINT("[PREFAULT 1 MiB OF VIRTUAL LINEAR ALLOCATOR]");
+		la_prefault(&allocator, 1 << 20);
+		PRINT_UINT(la_committed_space(&allocator));
+
+		// writing prefaulted memory takes no page faults
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		for (int i = 0; i < 256; i++)
+			*(int *)la_alloc(&allocator, 4096) = i;
+		getrusage(RUSAGE_SELF, &after);
+		const size_t page_faults = (size_t)(after.ru_minflt - before.ru_minflt);
+		PRINT_UINT(page_faults);
+
+		la_terminate(&allocator);
+		PRINT("[PREFAULTED ALLOCATOR DESTROYED]");
+	}
+#endif	// PREFAULT_TEST
+
+	//
+	// SAMPLED HEAP PROFILE
+	//
+#ifdef HEAP_PROFILE_TEST
+	{
+		LinearAllocator level;
+		la_init(&level, 1 << 20);
+		heap_profile_start(16 * 1024);
+		PRINT("[HEAP PROFILE STARTED]");
+
+		// about 3/4 of sampled bytes come from meshes
+		load_meshes(&level);
+		load_sounds(&level);
+		PRINT_UINT(heap_profile_num_of_samples());
+		PRINT_UINT(heap_profile_live_bytes(&level));
+		heap_profile_dump("heap_profile.folded");
+
+		// reset takes samples of the arena with it
+		la_reset(&level);
+		PRINT_UINT(heap_profile_num_of_samples());
+
+		heap_profile_stop();
+		la_terminate(&level);
+		remove("heap_profile.folded");
+		PRINT("[HEAP PROFILE STOPPED]");
+	}
+#endif	// HEAP_PROFILE_TEST
+
+	//
+	// REMOTE FREES
+	//
+#ifdef REMOTE_FREE_TEST
+	{
+		PoolAllocator pool;
+		pa_init(&pool, 4, 64);
+		pa_set_owner(&pool);
+		PRINT("[POOL OWNED BY MAIN THREAD]");
+
+		void *requests[5] = { &pool };
+		for (int i = 1; i < 5; i++)
+			requests[i] = pa_alloc(&pool);
+
+		// frees of another thread wait in the remote list
+		pthread_t worker;
+		pthread_create(&worker, NULL, release_requests, requests);
+		pthread_join(worker, NULL);
+		PRINT_HEX(pa_get_header(&pool));
+		PRINT_HEX(pool.remote);
+
+		// empty free list takes the remote one
+		void *reused = pa_alloc(&pool);
+		M_ASSERT(reused == requests[3], "Remote list was not reclaimed");
+		PRINT_HEX(pool.remote);
+		pa_free(&pool, reused);
+		pa_free(&pool, requests[4]);
+
+		pa_terminate(&pool);
+		PRINT("[OWNED POOL DESTROYED]");
+	}
+#endif	// REMOTE_FREE_TEST
+
+	//
+	// EPOCH ARENA
+	//
+#ifdef EPOCH_ARENA_TEST
+	{
+		EpochArena arena;
+		ea_init(&arena, 1 << 20);
+		EpochReader *reader = ea_register_reader(&arena);
+		PRINT("[EPOCH ARENA CREATED]");
+
+		// version 1 of routing table
+		int *table = la_alloc(ea_begin_build(&arena), 16 * sizeof(int));
+		table[0] = 1;
+		ea_publish(&arena, table);
+
+		// reader holds version 1 while version 2 is published
+		const int *seen = ea_read_lock(&arena, reader);
+		table = la_alloc(ea_begin_build(&arena), 16 * sizeof(int));
+		table[0] = 2;
+		ea_publish(&arena, table);
+		PRINT_UINT(seen[0]);
+		PRINT_UINT(ea_retired_generations(&arena));
+
+		// version 3 doesn't wait for the reader, it gets a new generation
+		table = la_alloc(ea_begin_build(&arena), 16 * sizeof(int));
+		table[0] = 3;
+		ea_publish(&arena, table);
+		PRINT_UINT(ea_num_of_generations(&arena));
+
+		// after the reader leaves both old versions are reset
+		ea_read_unlock(reader);
+		PRINT_UINT(ea_reclaim(&arena));
+		seen = ea_read_lock(&arena, reader);
+		PRINT_UINT(seen[0]);
+		ea_read_unlock(reader);
+
+		ea_unregister_reader(reader);
+		ea_terminate(&arena);
+		PRINT("[EPOCH ARENA DESTROYED]");
+	}
+#endif	// EPOCH_ARENA_TEST
+
+	//
+	// STATIC POOL
+	//
+#ifdef STATIC_POOL_TEST
+	{
+		PRINT("[STATIC PARTICLE POOL]");
+		Particle *first = Particle_pool_alloc();
+		Particle *second = Particle_pool_alloc();
+		first->lifetime = 1.0f;
+		PRINT_UINT(Particle_pool_index(second));
+
+		// freed slot comes back before untouched ones
+		Particle_pool_free(first);
+		Particle *reused = Particle_pool_alloc();
+		M_ASSERT(reused == first, "Freed slot was not reused");
+		M_ASSERT(Particle_pool_at(1) == second, "Index doesn't match slot");
+
+		// whole pool goes back at once
+		Particle_pool_reset();
+		int allocated = 0;
+		while (allocated < 2000 && Particle_pool_alloc() != NULL)
+			allocated++;
+		PRINT_UINT(allocated);
+		Particle_pool_reset();
+	}
+#endif	// STATIC_POOL_TEST
+
+	//
+	// MEMORY PROVIDERS
+	//
+#ifdef MEMORY_PROVIDER_TEST
+	{
+		// per-request arena in a static buffer, children are carved out of it
+		static char buffer[64 * 1024];
+		MemoryProvider buffer_provider, request_provider;
+		mp_init_buffer(&buffer_provider, buffer, sizeof(buffer));
+
+		LinearAllocator request;
+		la_init_from(&request, &buffer_provider, 32 * 1024);
+		mp_init_parent(&request_provider, ALLOCATOR_LINEAR, &request);
+		PRINT("[REQUEST ARENA CREATED]");
+
+		PoolAllocator sessions;
+		StackAllocator parser;
+		pa_init_from(&sessions, &request_provider, 16, 64, DEFAULT_ALIGNMENT);
+		sa_init_from(&parser, &request_provider, 4096);
+		PRINT_UINT(la_used_space(&request));
+
+		// child owns its memory inside the parent's range
+		void *session = pa_alloc(&sessions);
+		char *token = sa_alloc(&parser, 32);
+		AllocatorKind kind;
+		M_ASSERT(owner_lookup(session, &kind) == &sessions, "Session doesn't belong to its pool");
+		M_ASSERT(owner_lookup(token, &kind) == &parser, "Token doesn't belong to its stack");
+		alloc_free(token);
+		alloc_free(session);
+
+		// children give nothing back one by one, the request drops all of them in one reset
+		sa_terminate(&parser);
+		pa_terminate(&sessions);
+		la_reset(&request);
+		PRINT_UINT(la_used_space(&request));
+		la_terminate(&request);
+		M_ASSERT(buffer_provider.current == buffer, "Buffer wasn't given back");
+		PRINT("[REQUEST ARENA DESTROYED]");
+
+		// exhausted provider leaves the pool empty, it still resets and terminates
+		static char small_buffer[64];
+		MemoryProvider small_provider;
+		mp_init_buffer(&small_provider, small_buffer, sizeof(small_buffer));
+		PoolAllocator empty;
+		pa_init_from(&empty, &small_provider, 16, 64, DEFAULT_ALIGNMENT);
+		pa_reset(&empty);
+		void *nothing = pa_alloc(&empty);
+		M_ASSERT(nothing == NULL, "Empty pool returned an element");
+		pa_terminate(&empty);
+
+		// frame buffers committed on demand
+		MemoryProvider mmap_provider;
+		mp_init_mmap(&mmap_provider);
+		DoubleBufferedAllocator frames;
+		dba_init_from(&frames, &mmap_provider, 1 << 20);
+		dba_alloc(&frames, 100 * 1024);
+		PRINT_UINT(sa_committed_space(&frames.stack[frames.current_stack]));
+		dba_terminate(&frames);
+
+		// slabs from malloc
+		MemoryProvider malloc_provider;
+		mp_init_malloc(&malloc_provider);
+		GrowablePoolAllocator nodes;
+		gpa_init_from(&nodes, &malloc_provider, 48, 0, 0, DEFAULT_ALIGNMENT);
+		void *node = gpa_alloc(&nodes);
+		gpa_free(&nodes, node);
+		PRINT_UINT(gpa_num_of_slabs(&nodes));
+		gpa_terminate(&nodes);
+	}
+#endif	// MEMORY_PROVIDER_TEST
 	return 0;
 }
@@ -0,0 +1,222 @@
+#include "../include/allocation_trace.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT, PRINT_UINT
+#include <stdatomic.h>					// atomic_load_explicit, atomic_store_explicit
+#include <stdio.h>					// fopen, fwrite, fclose
+#include <stdlib.h>					// malloc, free
+#include <pthread.h>					// pthread_create, pthread_key_create, pthread_mutex_lock
+#include <time.h>					// clock_gettime, nanosleep
+
+// events per thread ring, power of two
+#define TRACE_BUFFER_CAPACITY		8192
+// background thread wakes up this often
+#define TRACE_FLUSH_INTERVAL_NS		1000000
+
+// single-producer (traced thread), single-consumer (flushing thread) ring
+struct TraceBuffer
+{
+	TraceEvent events[TRACE_BUFFER_CAPACITY];
+	_Atomic size_t head;			// next event to write
+	_Atomic size_t tail;			// next event to flush
+	_Atomic int retired;			// owner thread exited, free after flush
+	_Atomic size_t dropped;
+	uint32_t thread;
+	struct TraceBuffer *next;
+};
+
+int trace_enabled = 0;
+
+static FILE *trace_file = NULL;
+static pthread_t flush_thread;
+static _Atomic int flush_running = 0;
+
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceBuffer *buffers = NULL;
+static uint32_t thread_count = 0;
+static size_t dropped_total = 0;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t buffer_key;
+static _Thread_local struct TraceBuffer *thread_buffer = NULL;
+
+static void trace_retire_buffer(void *buffer)
+{
+	thread_buffer = NULL;
+	atomic_store_explicit(&((struct TraceBuffer *)buffer)->retired, 1, memory_order_release);
+}
+
+static void trace_create_key(void)
+{
+	pthread_key_create(&buffer_key, trace_retire_buffer);
+}
+
+static struct TraceBuffer *trace_thread_buffer(void)
+{
+	struct TraceBuffer *buffer = (struct TraceBuffer *)malloc(sizeof(struct TraceBuffer));
+	if (buffer == NULL)
+		return NULL;
+
+	atomic_init(&buffer->head, 0);
+	atomic_init(&buffer->tail, 0);
+	atomic_init(&buffer->retired, 0);
+	atomic_init(&buffer->dropped, 0);
+
+	pthread_once(&key_once, trace_create_key);
+	pthread_setspecific(buffer_key, buffer);
+
+	pthread_mutex_lock(&buffers_lock);
+	buffer->thread	= ++thread_count;
+	buffer->next	= buffers;
+	buffers			= buffer;
+	pthread_mutex_unlock(&buffers_lock);
+
+	return thread_buffer = buffer;
+}
+
+// writes events of one ring to the file, called with buffers_lock held
+static void trace_flush_buffer(struct TraceBuffer *buffer)
+{
+	const size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+	size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+
+	while (tail != head)
+	{
+		// events up to the end of array or up to head
+		const size_t index = tail & (TRACE_BUFFER_CAPACITY - 1);
+		size_t count = head - tail;
+		if (count > TRACE_BUFFER_CAPACITY - index)
+			count = TRACE_BUFFER_CAPACITY - index;
+
+		fwrite(&buffer->events[index], sizeof(TraceEvent), count, trace_file);
+		tail += count;
+	}
+	atomic_store_explicit(&buffer->tail, tail, memory_order_release);
+}
+
+static void trace_flush_all(void)
+{
+	pthread_mutex_lock(&buffers_lock);
+	struct TraceBuffer **link = &buffers;
+	while (*link != NULL)
+	{
+		struct TraceBuffer *buffer = *link;
+		const int retired = atomic_load_explicit(&buffer->retired, memory_order_acquire);
+		trace_flush_buffer(buffer);
+
+		// nobody writes to retired ring anymore
+		if (retired)
+		{
+			dropped_total += atomic_load_explicit(&buffer->dropped, memory_order_relaxed);
+			*link = buffer->next;
+			free(buffer);
+		}
+		else
+			link = &buffer->next;
+	}
+	fflush(trace_file);
+	pthread_mutex_unlock(&buffers_lock);
+}
+
+static void *trace_flush_loop(void *unused)
+{
+	const struct timespec interval = { 0, TRACE_FLUSH_INTERVAL_NS };
+	while (atomic_load_explicit(&flush_running, memory_order_acquire))
+	{
+		trace_flush_all();
+		nanosleep(&interval, NULL);
+	}
+	return NULL;
+}
+
+int trace_start(const char *path)
+{
+	M_ASSERT(path != NULL, "Path is NULL");
+	M_ASSERT(trace_file == NULL, "Tracing is already started");
+
+	trace_file = fopen(path, "wb");
+	if (trace_file == NULL)
+	{
+		PRINT("Unable to create trace file");
+		return 0;
+	}
+
+	const TraceFileHeader header = { TRACE_FILE_MAGIC, TRACE_FILE_VERSION, sizeof(TraceEvent) };
+	fwrite(&header, sizeof(header), 1, trace_file);
+
+	// hooks that raced with the last trace_stop may have left events of previous session
+	pthread_mutex_lock(&buffers_lock);
+	for (struct TraceBuffer *buffer = buffers; buffer != NULL; buffer = buffer->next)
+	{
+		atomic_store_explicit(&buffer->tail, atomic_load_explicit(&buffer->head, memory_order_acquire), memory_order_release);
+		atomic_store_explicit(&buffer->dropped, 0, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&buffers_lock);
+
+	atomic_store_explicit(&flush_running, 1, memory_order_release);
+	if (pthread_create(&flush_thread, NULL, trace_flush_loop, NULL) != 0)
+	{
+		PRINT("Unable to start flushing thread");
+		fclose(trace_file);
+		trace_file = NULL;
+		return 0;
+	}
+
+	// hooks that see the flag see the file and the flushing thread
+	__atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+void trace_stop(void)
+{
+	if (trace_file == NULL)
+		return;
+
+	__atomic_store_n(&trace_enabled, 0, __ATOMIC_RELEASE);
+	atomic_store_explicit(&flush_running, 0, memory_order_release);
+	pthread_join(flush_thread, NULL);
+
+	// rings of live threads are kept for the next trace_start
+	trace_flush_all();
+	pthread_mutex_lock(&buffers_lock);
+	for (struct TraceBuffer *buffer = buffers; buffer != NULL; buffer = buffer->next)
+	{
+		dropped_total += atomic_exchange_explicit(&buffer->dropped, 0, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&buffers_lock);
+
+	PRINT_UINT(dropped_total);
+	dropped_total = 0;
+
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+void trace_record(const TraceEventType type, const AllocatorKind kind, const void *allocator,
+				  const void *ptr, const size_t size, const size_t alignment)
+{
+	struct TraceBuffer *buffer = thread_buffer;
+	if (buffer == NULL && (buffer = trace_thread_buffer()) == NULL)
+		return;
+
+	const size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&buffer->tail, memory_order_acquire) == TRACE_BUFFER_CAPACITY)
+	{
+		atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	TraceEvent *event	= &buffer->events[head & (TRACE_BUFFER_CAPACITY - 1)];
+	event->timestamp	= (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+	event->allocator	= (uint64_t)(size_t)allocator;
+	event->ptr			= (uint64_t)(size_t)ptr;
+	event->size			= (uint64_t)size;
+	event->thread		= buffer->thread;
+	event->type			= (uint8_t)type;
+	event->kind			= (uint8_t)kind;
+	event->alignment_log2	= (alignment == 0) ? 0 : (uint8_t)__builtin_ctzll(alignment);
+	event->reserved		= 0;
+
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
@@ -0,0 +1,210 @@
+#include "../include/arena_containers.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/linear_allocator.h"		// la_alloc_aligned, la_resize
+#include "../include/stack_allocator.h"		// sa_alloc_aligned, sa_resize
+#include <string.h>					// memcpy, memset, strlen
+
+#define MIN_MAP_CAPACITY		8
+
+// fibonacci hashing, top bits of the product are the best mixed ones
+#define MAP_HASH(map, key)		((size_t)(((key) * 0x9E3779B97F4A7C15ULL) >> (map)->shift))
+
+void *arena_alloc(Arena arena, const size_t size, const size_t alignment)
+{
+	M_ASSERT(arena.kind == ALLOCATOR_LINEAR || arena.kind == ALLOCATOR_STACK, "Arena is neither linear nor stack allocator");
+	if (arena.kind == ALLOCATOR_STACK)
+		return sa_alloc_aligned((StackAllocator *)arena.allocator, size, alignment);
+	return la_alloc_aligned((LinearAllocator *)arena.allocator, size, alignment);
+}
+
+void *arena_grow(Arena arena, void *ptr, const size_t old_size, const size_t new_size, const size_t alignment)
+{
+	if (ptr != NULL)
+	{
+		const int resized = (arena.kind == ALLOCATOR_STACK)
+			? sa_resize((StackAllocator *)arena.allocator, ptr, old_size, new_size)
+			: la_resize((LinearAllocator *)arena.allocator, ptr, old_size, new_size);
+		if (resized)
+			return ptr;
+	}
+
+	void *block = arena_alloc(arena, new_size, alignment);
+	if (block != NULL && ptr != NULL)
+		memcpy(block, ptr, old_size < new_size ? old_size : new_size);
+	return block;
+}
+
+//
+// DYNAMIC ARRAY
+//
+void arr_init(ArenaArray *array, Arena arena, const size_t element_size, const size_t capacity)
+{
+	M_ASSERT(array != NULL, "Array is NULL");
+	array->arena		= arena;
+	array->data			= NULL;
+	array->count		= 0;
+	array->capacity		= 0;
+	array->element_size	= element_size;
+	if (capacity != 0)
+		arr_reserve(array, capacity);
+}
+
+int arr_reserve(ArenaArray *array, const size_t capacity)
+{
+	M_ASSERT(array != NULL, "Array is NULL");
+	if (capacity <= array->capacity)
+		return 1;
+
+	char *data = arena_grow(array->arena, array->data, array->capacity * array->element_size, capacity * array->element_size, DEFAULT_ALIGNMENT);
+	if (data == NULL)
+		return 0;
+
+	array->data		= data;
+	array->capacity	= capacity;
+	return 1;
+}
+
+void *arr_push(ArenaArray *array)
+{
+	M_ASSERT(array != NULL, "Array is NULL");
+	if (UNLIKELY(array->count == array->capacity) && !arr_reserve(array, array->capacity ? 2 * array->capacity : 16))
+		return NULL;
+	return array->data + array->count++ * array->element_size;
+}
+
+//
+// HASH MAP
+//
+
+// table is rebuilt, it can't grow in place because every key moves
+static NOINLINE int map_grow(ArenaMap *map, const size_t capacity)
+{
+	struct MapEntry *entries = arena_alloc(map->arena, capacity * (sizeof(struct MapEntry) + 1), DEFAULT_ALIGNMENT);
+	if (entries == NULL)
+		return 0;
+
+	uint8_t *occupied = (uint8_t *)(entries + capacity);
+	memset(occupied, 0, capacity);
+
+	ArenaMap grown = *map;
+	grown.entries	= entries;
+	grown.occupied	= occupied;
+	grown.capacity	= capacity;
+	grown.shift		= 64 - __builtin_ctzll(capacity);
+
+	for (size_t i = 0; i < map->capacity; i++)
+	{
+		if (!map->occupied[i])
+			continue;
+
+		size_t index = MAP_HASH(&grown, map->entries[i].key);
+		while (occupied[index])
+			index = (index + 1) & (capacity - 1);
+		occupied[index] = 1;
+		entries[index] = map->entries[i];
+	}
+
+	*map = grown;
+	return 1;
+}
+
+void map_init(ArenaMap *map, Arena arena, const size_t capacity)
+{
+	M_ASSERT(map != NULL, "Map is NULL");
+	map->arena		= arena;
+	map->entries	= NULL;
+	map->occupied	= NULL;
+	map->count		= 0;
+	map->capacity	= 0;
+
+	// room for 'capacity' keys without growing
+	size_t table_size = MIN_MAP_CAPACITY;
+	while (table_size * 3 < capacity * 4)
+		table_size <<= 1;
+	map_grow(map, table_size);
+}
+
+int map_put(ArenaMap *map, const uint64_t key, const uint64_t value)
+{
+	M_ASSERT(map != NULL, "Map is NULL");
+
+	// load factor stays under 3/4
+	if (UNLIKELY((map->count + 1) * 4 > map->capacity * 3) && !map_grow(map, map->capacity ? 2 * map->capacity : MIN_MAP_CAPACITY))
+		return 0;
+
+	size_t index = MAP_HASH(map, key);
+	while (map->occupied[index])
+	{
+		if (map->entries[index].key == key)
+		{
+			map->entries[index].value = value;
+			return 1;
+		}
+		index = (index + 1) & (map->capacity - 1);
+	}
+
+	map->occupied[index]	= 1;
+	map->entries[index]		= (struct MapEntry){ key, value };
+	map->count++;
+	return 1;
+}
+
+uint64_t *map_get(ArenaMap *map, const uint64_t key)
+{
+	M_ASSERT(map != NULL, "Map is NULL");
+	if (map->capacity == 0)
+		return NULL;
+
+	size_t index = MAP_HASH(map, key);
+	while (map->occupied[index])
+	{
+		if (map->entries[index].key == key)
+			return &map->entries[index].value;
+		index = (index + 1) & (map->capacity - 1);
+	}
+	return NULL;
+}
+
+//
+// STRING BUILDER
+//
+void sb_init(StringBuilder *builder, Arena arena, const size_t capacity)
+{
+	M_ASSERT(builder != NULL, "String builder is NULL");
+	builder->arena		= arena;
+	builder->length		= 0;
+	builder->capacity	= 0;
+	builder->data		= arena_alloc(arena, capacity + 1, 1);
+	if (builder->data != NULL)
+	{
+		builder->data[0]	= '\0';
+		builder->capacity	= capacity;
+	}
+}
+
+int sb_append(StringBuilder *builder, const char *text, const size_t length)
+{
+	M_ASSERT(builder != NULL, "String builder is NULL");
+	if (UNLIKELY(builder->length + length > builder->capacity))
+	{
+		size_t capacity = builder->capacity ? 2 * builder->capacity : 16;
+		while (capacity < builder->length + length)
+			capacity *= 2;
+
+		char *data = arena_grow(builder->arena, builder->data, builder->capacity + 1, capacity + 1, 1);
+		if (data == NULL)
+			return 0;
+		builder->data		= data;
+		builder->capacity	= capacity;
+	}
+
+	memcpy(builder->data + builder->length, text, length);
+	builder->length += length;
+	builder->data[builder->length] = '\0';
+	return 1;
+}
+
+int sb_append_string(StringBuilder *builder, const char *text)
+{
+	return sb_append(builder, text, strlen(text));
+}
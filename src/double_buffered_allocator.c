@@ -1,5 +1,50 @@
 #include "../include/double_buffered_allocator.h"
 #include "../debug/debug.h"				// M_ASSERT, PRINT, show_memory
+#include "../include/memory.h"				// ALIGN_POINTER, DEFAULT_ALIGNMENT, UNLIKELY, NOINLINE
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_SWAP
+#include "../include/owner_registry.h"			// owner_register, owner_unregister
+#include <stdlib.h>					// malloc, realloc, free
+#include <string.h>					// memcpy
+
+#define SPILL_CHUNK_SIZE		((size_t)64 << 10)
+#define MIN_ADAPTIVE_SIZE		((size_t)4 << 10)
+
+// heap memory of a frame that didn't fit its buffer
+struct SpillChunk
+{
+	struct SpillChunk *next;
+	char *current;
+	char *end;
+};
+
+struct DbaAdaptive
+{
+	size_t peaks[DBA_MAX_WINDOW];			// ring of frame peaks
+	size_t window;
+	size_t count;
+	size_t next;
+	size_t headroom_percent;
+	size_t frame_peak;
+	struct SpillChunk *spill[2];
+	size_t spilled[2];				// bytes taken from spill chunks by each buffer
+};
+
+struct DbaCopying
+{
+	DbaObjectSize size;
+	DbaObjectTrace trace;
+	void *context;
+	void ***roots;
+	size_t num_of_roots;
+	size_t roots_capacity;
+	StackAllocator *from;				// valid while copying
+	StackAllocator *to;
+	size_t not_forwarded;				// references left in from-space by the last swap
+};
+
+// stack blocks start with their size, block of a copied object keeps forwarding address instead
+#define BLOCK_HEADER(object)		((size_t *)((char *)(object) - sizeof(size_t)))
+#define FORWARDED				((size_t)1)
 
 void dba_init(DoubleBufferedAllocator *allocator, const size_t total_size)
 {
@@ -7,18 +52,110 @@ void dba_init(DoubleBufferedAllocator *allocator, const size_t total_size)
 	sa_init(&allocator->stack[0], total_size);
 	sa_init(&allocator->stack[1], total_size);
 	allocator->current_stack = 0;
+	allocator->adaptive = NULL;
+	allocator->copying = NULL;
+}
+
+void dba_init_from(DoubleBufferedAllocator *allocator, MemoryProvider *provider, const size_t total_size)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	sa_init_from(&allocator->stack[0], provider, total_size);
+	sa_init_from(&allocator->stack[1], provider, total_size);
+	allocator->current_stack = 0;
+	allocator->adaptive = NULL;
+	allocator->copying = NULL;
+}
+
+void dba_init_adaptive(DoubleBufferedAllocator *allocator, const size_t initial_size, const size_t window, const size_t headroom_percent)
+{
+	M_ASSERT(window != 0 && window <= DBA_MAX_WINDOW, "Incorrect window");
+	dba_init(allocator, initial_size);
+
+	struct DbaAdaptive *adaptive = calloc(1, sizeof(struct DbaAdaptive));
+	if (adaptive == NULL)
+	{
+		PRINT("Unable to allocate adaptive state, buffers keep their size");
+		return;
+	}
+	adaptive->window			= window;
+	adaptive->headroom_percent	= headroom_percent;
+	allocator->adaptive			= adaptive;
+}
+
+// released together with reset of the stack, which drops spilled blocks from trace too
+static void spill_release(DoubleBufferedAllocator *allocator, const unsigned int stack)
+{
+	struct DbaAdaptive *adaptive = allocator->adaptive;
+	while (adaptive->spill[stack] != NULL)
+	{
+		struct SpillChunk *next = adaptive->spill[stack]->next;
+		owner_unregister(allocator, adaptive->spill[stack]);
+		free(adaptive->spill[stack]);
+		adaptive->spill[stack] = next;
+	}
+	adaptive->spilled[stack] = 0;
+}
+
+// bumps in the newest chunk, adds a chunk when it's full
+static NOINLINE void *dba_spill(DoubleBufferedAllocator *allocator, const size_t size, const size_t alignment)
+{
+	struct DbaAdaptive *adaptive = allocator->adaptive;
+	const unsigned int stack = allocator->current_stack;
+	struct SpillChunk *chunk = adaptive->spill[stack];
+
+	char *ptr = (chunk != NULL) ? ALIGN_POINTER(chunk->current, alignment) : NULL;
+	if (chunk == NULL || ptr + size > chunk->end)
+	{
+		const size_t needed = sizeof(struct SpillChunk) + alignment + size;
+		const size_t chunk_size = (needed > SPILL_CHUNK_SIZE) ? needed : SPILL_CHUNK_SIZE;
+		chunk = malloc(chunk_size);
+		if (chunk == NULL)
+		{
+			PRINT("There is no available space");
+			return NULL;
+		}
+		chunk->next		= adaptive->spill[stack];
+		chunk->current	= (char *)(chunk + 1);
+		chunk->end		= (char *)chunk + chunk_size;
+		adaptive->spill[stack] = chunk;
+		ptr = ALIGN_POINTER(chunk->current, alignment);
+
+		// alloc_free leaves spilled blocks until reset, like dba_free
+		owner_register(allocator, ALLOCATOR_DOUBLE_BUFFERED, chunk, chunk->end);
+	}
+
+	adaptive->spilled[stack] += (size_t)(ptr + size - chunk->current);
+	chunk->current = ptr + size;
+
+	// block belongs to the frame of the stack, so does its peak
+	TRACE_ALLOC(ALLOCATOR_STACK, &allocator->stack[stack], ptr, size, alignment);
+	return ptr;
 }
 
 void *dba_alloc_aligned(DoubleBufferedAllocator *allocator, const size_t size, const size_t alignment)
 {
 	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
-	return sa_alloc_aligned(&allocator->stack[allocator->current_stack], size, alignment);
+	StackAllocator *stack = &allocator->stack[allocator->current_stack];
+	struct DbaAdaptive *adaptive = allocator->adaptive;
+	if (adaptive == NULL)
+		return sa_alloc_aligned(stack, size, alignment);
+
+	// block header and padding included, too big blocks go to spill without trying the stack
+	void *ptr = (size + alignment + sizeof(size_t) <= sa_remaining_space(stack))
+		? sa_alloc_aligned(stack, size, alignment)
+		: NULL;
+	if (UNLIKELY(ptr == NULL))
+		ptr = dba_spill(allocator, size, alignment);
+
+	const size_t used = sa_used_space(stack) + adaptive->spilled[allocator->current_stack];
+	if (used > adaptive->frame_peak)
+		adaptive->frame_peak = used;
+	return ptr;
 }
 
 void *dba_alloc(DoubleBufferedAllocator *allocator, const size_t size)
 {
-	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
-	return sa_alloc(&allocator->stack[allocator->current_stack], size);
+	return dba_alloc_aligned(allocator, size, DEFAULT_ALIGNMENT);
 }
 
 void dba_free(DoubleBufferedAllocator *allocator, void *ptr)
@@ -30,26 +167,201 @@ void dba_free(DoubleBufferedAllocator *allocator, void *ptr)
 #else
 	ASSERT(ptr != NULL);
 #endif
-	sa_free(&allocator->stack[allocator->current_stack], ptr);
+	StackAllocator *stack = &allocator->stack[allocator->current_stack];
+
+	// spilled blocks live until the buffer is reset
+	if (allocator->adaptive != NULL && ((char *)ptr < stack->start || (char *)ptr >= stack->end))
+		return;
+	sa_free(stack, ptr);
+}
+
+// p99 of frame peaks in the window
+static size_t window_percentile(const struct DbaAdaptive *adaptive)
+{
+	size_t sorted[DBA_MAX_WINDOW];
+	const size_t count = adaptive->count;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t j = i;
+		for (; j > 0 && sorted[j - 1] > adaptive->peaks[i]; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = adaptive->peaks[i];
+	}
+	return sorted[(count * 99) / 100 - ((count * 99) % 100 == 0)];
+}
+
+// buffer being reused is reset, grown or shrunk to the p99 of recent frames
+static void dba_adapt(DoubleBufferedAllocator *allocator)
+{
+	struct DbaAdaptive *adaptive = allocator->adaptive;
+	adaptive->peaks[adaptive->next] = adaptive->frame_peak;
+	adaptive->next = (adaptive->next + 1) % adaptive->window;
+	if (adaptive->count < adaptive->window)
+		adaptive->count++;
+	adaptive->frame_peak = 0;
+
+	const unsigned int current = allocator->current_stack;
+	StackAllocator *stack = &allocator->stack[current];
+	spill_release(allocator, current);
+
+	size_t target = window_percentile(adaptive);
+	target += target * adaptive->headroom_percent / 100;
+	if (target < MIN_ADAPTIVE_SIZE)
+		target = MIN_ADAPTIVE_SIZE;
+
+	// shrinking waits until the buffer is half as big again as needed
+	const size_t size = (size_t)(stack->end - stack->start);
+	if (size < target || size > target + target / 2)
+	{
+		sa_terminate(stack);
+		sa_init(stack, target);
+	}
+	else
+		sa_reset(stack);
 }
 
-void dba_swap_buffers(DoubleBufferedAllocator *allocator)
+void dba_enable_copying(DoubleBufferedAllocator *allocator, DbaObjectSize size, DbaObjectTrace trace, void *context)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	M_ASSERT(size != NULL && trace != NULL, "Object callbacks are NULL");
+
+	struct DbaCopying *copying = allocator->copying ? allocator->copying : calloc(1, sizeof(struct DbaCopying));
+	if (copying == NULL)
+	{
+		PRINT("Unable to allocate copying state");
+		return;
+	}
+	copying->size		= size;
+	copying->trace		= trace;
+	copying->context	= context;
+	allocator->copying	= copying;
+}
+
+int dba_add_root(DoubleBufferedAllocator *allocator, void **root)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	M_ASSERT(allocator->copying != NULL, "Copying mode is not enabled");
+	struct DbaCopying *copying = allocator->copying;
+
+	if (copying->num_of_roots == copying->roots_capacity)
+	{
+		const size_t capacity = copying->roots_capacity ? 2 * copying->roots_capacity : 16;
+		void ***roots = realloc(copying->roots, capacity * sizeof(void **));
+		if (roots == NULL)
+		{
+			PRINT("Unable to add root");
+			return 0;
+		}
+		copying->roots			= roots;
+		copying->roots_capacity	= capacity;
+	}
+	copying->roots[copying->num_of_roots++] = root;
+	return 1;
+}
+
+void dba_remove_root(DoubleBufferedAllocator *allocator, void **root)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	struct DbaCopying *copying = allocator->copying;
+	for (size_t i = 0; copying != NULL && i < copying->num_of_roots; i++)
+		if (copying->roots[i] == root)
+		{
+			copying->roots[i] = copying->roots[--copying->num_of_roots];
+			return;
+		}
+}
+
+// moves object the field points to into to-space, once
+static void forward(void **field, void *state)
+{
+	struct DbaCopying *copying = (struct DbaCopying *)state;
+	char *object = (char *)*field;
+	if (object < copying->from->start + sizeof(size_t) || object >= copying->from->current)
+		return;
+
+	size_t *header = BLOCK_HEADER(object);
+	if (*header & FORWARDED)
+	{
+		*field = (void *)(*header & ~FORWARDED);
+		return;
+	}
+
+	const size_t size = copying->size(object, copying->context);
+	char *copy = sa_alloc(copying->to, size);
+	if (copy == NULL)
+	{
+		copying->not_forwarded++;
+		return;
+	}
+
+	memcpy(copy, object, size);
+	*header = (size_t)copy | FORWARDED;
+	*field = copy;
+}
+
+// roots are copied first, then every copied object is scanned in allocation order:
+// blocks with default alignment lie back to back, so to-space itself is the queue
+static size_t dba_copy_survivors(DoubleBufferedAllocator *allocator)
+{
+	struct DbaCopying *copying = allocator->copying;
+	copying->from	= &allocator->stack[!allocator->current_stack];
+	copying->to		= &allocator->stack[allocator->current_stack];
+	copying->not_forwarded = 0;
+
+	for (size_t i = 0; i < copying->num_of_roots; i++)
+		forward(copying->roots[i], copying);
+
+	for (char *block = copying->to->start; block < copying->to->current; block += *(size_t *)block)
+		copying->trace(block + sizeof(size_t), forward, copying, copying->context);
+
+	copying->from = copying->to = NULL;
+	if (copying->not_forwarded != 0)
+		PRINT("Survivors don't fit the buffer");
+	return copying->not_forwarded;
+}
+
+size_t dba_swap_buffers(DoubleBufferedAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
 	allocator->current_stack = !allocator->current_stack;
+	if (allocator->adaptive != NULL)
+		dba_adapt(allocator);
+	else if (allocator->copying != NULL)
+		sa_reset(&allocator->stack[allocator->current_stack]);
+
+	// allocations themselves are traced by the stack, this tells which stack it is
+	TRACE_SWAP(ALLOCATOR_DOUBLE_BUFFERED, allocator, &allocator->stack[allocator->current_stack]);
+
+	return (allocator->copying != NULL) ? dba_copy_survivors(allocator) : 0;
 }
 
 void dba_reset(DoubleBufferedAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
 	sa_reset(&allocator->stack[allocator->current_stack]);
+	if (allocator->adaptive != NULL)
+		spill_release(allocator, allocator->current_stack);
 }
 
 void dba_terminate(DoubleBufferedAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
-	sa_terminate(&allocator->stack[0]);
+	// buffers are given back in reverse order, stack-like providers release only their top block
 	sa_terminate(&allocator->stack[1]);
+	sa_terminate(&allocator->stack[0]);
+	if (allocator->adaptive != NULL)
+	{
+		spill_release(allocator, 0);
+		spill_release(allocator, 1);
+		free(allocator->adaptive);
+		allocator->adaptive = NULL;
+	}
+	if (allocator->copying != NULL)
+	{
+		free(allocator->copying->roots);
+		free(allocator->copying);
+		allocator->copying = NULL;
+	}
 }
 
 // For debug purposes
@@ -82,6 +394,19 @@ const size_t dba_remaining_space(DoubleBufferedAllocator *allocator)
 	return sa_remaining_space(&allocator->stack[allocator->current_stack]);
 }
 
+const size_t dba_buffer_size(DoubleBufferedAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	const StackAllocator *stack = &allocator->stack[allocator->current_stack];
+	return (const size_t)(stack->end - stack->start);
+}
+
+const size_t dba_spilled_space(DoubleBufferedAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Double-Buffered Allocator is NULL");
+	return allocator->adaptive ? allocator->adaptive->spilled[allocator->current_stack] : 0;
+}
+
 void dba_space_info(DoubleBufferedAllocator *allocator)
 {
 	PRINT_UINT(dba_used_space(allocator));
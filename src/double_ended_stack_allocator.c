@@ -1,10 +1,16 @@
 #include "../include/double_ended_stack_allocator.h"
 #include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
 #include "../debug/debug.h"				// M_ASSERT, ASSERT, PRINT, show_memory
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include "../include/owner_registry.h"			// owner_register, owner_unregister
+#include "../include/memory_provider.h"		// mp_acquire, mp_release
 #include <stdlib.h>					// malloc, free
 
 #define SIZE_OF_ALLOCATION_BLOCK_SIZE		sizeof(size_t)
 
+// lower stack block that starts with alignment padding, the padding size is stored before the block size
+#define PADDED_BLOCK				((size_t)2)
+
 void desa_init(DoubleEndedStackAllocator *allocator, const size_t total_size)
 {
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
@@ -12,19 +18,42 @@ void desa_init(DoubleEndedStackAllocator *allocator, const size_t total_size)
 	allocator->end 				= allocator->start + total_size;
 	allocator->current_front	= allocator->start;
 	allocator->current_back		= allocator->end;
+	allocator->provider			= NULL;
+	owner_register(allocator, ALLOCATOR_DOUBLE_ENDED, allocator->start, allocator->end);
+	MEMSET_ZERO(allocator->start, total_size);
+}
+
+void desa_init_from(DoubleEndedStackAllocator *allocator, MemoryProvider *provider, const size_t total_size)
+{
+	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
+	allocator->start 			= (char *)mp_acquire(provider, total_size, DEFAULT_ALIGNMENT);
+	allocator->end 				= allocator->start ? allocator->start + total_size : NULL;
+	allocator->current_front	= allocator->start;
+	allocator->current_back		= allocator->end;
+	allocator->provider			= provider;
+	if (allocator->start == NULL)
+		return;
+	owner_register(allocator, ALLOCATOR_DOUBLE_ENDED, allocator->start, allocator->end);
 	MEMSET_ZERO(allocator->start, total_size);
 }
 
 void desa_terminate(DoubleEndedStackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
-	free(allocator->start);
+	TRACE_RESET(ALLOCATOR_DOUBLE_ENDED, allocator);
+	owner_unregister(allocator, allocator->start);
+	if (allocator->provider != NULL)
+		mp_release(allocator->provider, allocator->start, (size_t)(allocator->end - allocator->start));
+	else
+		free(allocator->start);
+	allocator->provider = NULL;
 	allocator->start = allocator->end = allocator->current_front = allocator->current_back = NULL;
 }
 
 void desa_reset(DoubleEndedStackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
+	TRACE_RESET(ALLOCATOR_DOUBLE_ENDED, allocator);
 	allocator->current_front	= allocator->start;
 	allocator->current_back		= allocator->end;
 	MEMSET_ZERO(allocator->start, (const size_t)(allocator->end - allocator->start));
@@ -39,20 +68,26 @@ void *desa_front_alloc_aligned(DoubleEndedStackAllocator *allocator, const size_
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
 	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
 
-	const size_t aligned_size = ALIGNED_SIZE(SIZE_OF_ALLOCATION_BLOCK_SIZE + size, alignment);
+	// the same block layout as in stack allocator: padding, size, aligned allocation, padding
+	char *ptr = ALIGN_POINTER(allocator->current_front + SIZE_OF_ALLOCATION_BLOCK_SIZE, alignment < DEFAULT_ALIGNMENT ? DEFAULT_ALIGNMENT : alignment);
+	const size_t aligned_size = (size_t)(ALIGN_POINTER(ptr + size, DEFAULT_ALIGNMENT) - allocator->current_front);
 
-	if (allocator->current_front + aligned_size > allocator->current_back)
+	if (aligned_size > (size_t)(allocator->current_back - allocator->current_front))
 	{
 		PRINT("There is no available space for lower stack");
 		return NULL;
 	}
 
-	char *ptr = (char *)allocator->current_front;
-
-	*((size_t *)ptr) = aligned_size;
-	ptr += SIZE_OF_ALLOCATION_BLOCK_SIZE;
+	size_t *header = (size_t *)(ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE);
+	*header = aligned_size;
+	if ((char *)header != allocator->current_front)
+	{
+		header[-1] = (size_t)((char *)header - allocator->current_front);
+		*header |= PADDED_BLOCK;
+	}
 
 	allocator->current_front += aligned_size;
+	TRACE_ALLOC(ALLOCATOR_DOUBLE_ENDED, allocator, ptr, size, alignment);
 	return (void *)ptr;
 }
 
@@ -72,19 +107,20 @@ void desa_front_free(DoubleEndedStackAllocator *allocator, void *ptr)
 #endif
 	M_ASSERT(((char *)ptr > allocator->start) && ((char *)ptr < allocator->current_front), "Pointer is out of the stack borders");
 
-	char *temp_ptr = (char *)ptr;
-
-	temp_ptr -= SIZE_OF_ALLOCATION_BLOCK_SIZE;
-	const size_t allocation_size = *((size_t *)temp_ptr);
+	size_t *header = (size_t *)((char *)ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE);
+	const size_t allocation_size = *header & ~PADDED_BLOCK;
+	char *block_start = (char *)header - ((*header & PADDED_BLOCK) ? header[-1] : 0);
 
-	M_ASSERT(allocation_size == (const size_t)(allocator->current_front - temp_ptr), "Attempt to free non-top block of lower stack");
+	M_ASSERT(block_start + allocation_size == allocator->current_front, "Attempt to free non-top block of lower stack");
 
-	allocator->current_front -= allocation_size;
+	allocator->current_front = block_start;
+	TRACE_FREE(ALLOCATOR_DOUBLE_ENDED, allocator, ptr);
 }
 
 void desa_front_reset(DoubleEndedStackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
+	TRACE_RESET_RANGE(ALLOCATOR_DOUBLE_ENDED, allocator, allocator->start, (size_t)(allocator->current_front - allocator->start));
 	allocator->current_front 	= allocator->start;
 }
 
@@ -97,25 +133,28 @@ void *desa_back_alloc_aligned(DoubleEndedStackAllocator *allocator, const size_t
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
 	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
 
-	const size_t aligned_size = ALIGNED_SIZE(SIZE_OF_ALLOCATION_BLOCK_SIZE + size, alignment);
+	if (SIZE_OF_ALLOCATION_BLOCK_SIZE + size > (size_t)(allocator->current_back - allocator->current_front))
+	{
+		PRINT("There is no available space for upper stack");
+		return NULL;
+	}
 
-	if (allocator->current_back - aligned_size < allocator->current_front)
+	// block grows down: size, allocation aligned to 'alignment', padding up to old current_back
+	char *ptr = ALIGN_POINTER_DOWN(allocator->current_back - size, alignment < DEFAULT_ALIGNMENT ? DEFAULT_ALIGNMENT : alignment);
+	if (ptr < allocator->current_front + SIZE_OF_ALLOCATION_BLOCK_SIZE)
 	{
 		PRINT("There is no available space for upper stack");
 		return NULL;
 	}
 
+	// store block size right before allocation
+	const size_t aligned_size = (size_t)(allocator->current_back - ptr) + SIZE_OF_ALLOCATION_BLOCK_SIZE;
+	*((size_t *)(ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE)) = aligned_size;
+
 	// move current pointer left to aligned_size bytes
 	allocator->current_back -= aligned_size;
 
-	char *ptr = (char *)allocator->current_back;
-
-	// store current address os current_back pointer 
-	*((size_t *)ptr) = aligned_size;
-	
-	// move pointer to 4 bytes right
-	ptr += SIZE_OF_ALLOCATION_BLOCK_SIZE;
-
+	TRACE_ALLOC(ALLOCATOR_DOUBLE_ENDED, allocator, ptr, size, alignment);
 	return (void *)ptr;
 }
 
@@ -143,11 +182,13 @@ void desa_back_free(DoubleEndedStackAllocator *allocator, void *ptr)
 	M_ASSERT(temp_ptr == (char *)(allocator->current_back), "Attempt to free non-top block of upper stack");
 
 	allocator->current_back += allocation_size;
+	TRACE_FREE(ALLOCATOR_DOUBLE_ENDED, allocator, ptr);
 }
 
 void desa_back_reset(DoubleEndedStackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Double-Ended Stack Allocator is NULL");
+	TRACE_RESET_RANGE(ALLOCATOR_DOUBLE_ENDED, allocator, allocator->current_back, (size_t)(allocator->end - allocator->current_back));
 	allocator->current_back 	= allocator->end;
 }
 
@@ -0,0 +1,156 @@
+#include "../include/epoch_arena.h"
+#include "../debug/debug.h"			// M_ASSERT, PRINT
+#include <string.h>				// memset
+
+// state of a generation
+enum { GENERATION_FREE, GENERATION_BUILDING, GENERATION_PUBLISHED, GENERATION_RETIRED };
+
+void ea_init(EpochArena *arena, const size_t generation_size)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	memset(arena, 0, sizeof(EpochArena));
+	arena->epoch		= 1;
+	arena->generation_size	= generation_size;
+}
+
+void ea_terminate(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	for (size_t i = 0; i < arena->num_of_generations; i++)
+		la_terminate(&arena->generations[i].allocator);
+	arena->num_of_generations	= 0;
+	arena->building			= NULL;
+	arena->published		= NULL;
+	arena->root			= NULL;
+}
+
+// oldest epoch a reader may still be in, every generation retired before it is unreachable
+static uint64_t oldest_reader_epoch(EpochArena *arena)
+{
+	uint64_t oldest = __atomic_load_n(&arena->epoch, __ATOMIC_SEQ_CST);
+	for (size_t i = 0; i < EPOCH_MAX_READERS; i++)
+	{
+		const uint64_t epoch = __atomic_load_n(&arena->readers[i].epoch, __ATOMIC_SEQ_CST);
+		if (epoch != 0 && epoch < oldest)
+			oldest = epoch;
+	}
+	return oldest;
+}
+
+size_t ea_reclaim(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	const uint64_t oldest = oldest_reader_epoch(arena);
+	size_t reclaimed = 0;
+	for (size_t i = 0; i < arena->num_of_generations; i++)
+	{
+		struct EpochGeneration *generation = &arena->generations[i];
+		if (generation->state == GENERATION_RETIRED && generation->retired_epoch < oldest)
+		{
+			la_reset(&generation->allocator);
+			generation->state = GENERATION_FREE;
+			reclaimed++;
+		}
+	}
+	return reclaimed;
+}
+
+LinearAllocator *ea_begin_build(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	M_ASSERT(arena->building == NULL, "Previous generation isn't published");
+	ea_reclaim(arena);
+
+	struct EpochGeneration *generation = NULL;
+	for (size_t i = 0; i < arena->num_of_generations && generation == NULL; i++)
+	{
+		if (arena->generations[i].state == GENERATION_FREE)
+			generation = &arena->generations[i];
+	}
+
+	// readers still hold every retired generation, build doesn't wait for them
+	if (generation == NULL)
+	{
+		if (arena->num_of_generations == EPOCH_MAX_GENERATIONS)
+		{
+			PRINT("All generations are still read");
+			return NULL;
+		}
+		generation = &arena->generations[arena->num_of_generations];
+		la_init_virtual(&generation->allocator, arena->generation_size, 0);
+		if (generation->allocator.start == NULL)
+			return NULL;
+		arena->num_of_generations++;
+	}
+
+	generation->state = GENERATION_BUILDING;
+	arena->building = generation;
+	return &generation->allocator;
+}
+
+void ea_publish(EpochArena *arena, void *root)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	M_ASSERT(arena->building != NULL, "Nothing is built");
+
+	// readers that see the new epoch see the new root too
+	__atomic_store_n(&arena->root, root, __ATOMIC_SEQ_CST);
+	const uint64_t retired_epoch = __atomic_fetch_add(&arena->epoch, 1, __ATOMIC_SEQ_CST);
+
+	if (arena->published != NULL)
+	{
+		arena->published->retired_epoch	= retired_epoch;
+		arena->published->state		= GENERATION_RETIRED;
+	}
+	arena->published	= arena->building;
+	arena->published->state	= GENERATION_PUBLISHED;
+	arena->building		= NULL;
+	ea_reclaim(arena);
+}
+
+EpochReader *ea_register_reader(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	for (size_t i = 0; i < EPOCH_MAX_READERS; i++)
+	{
+		int expected = 0;
+		if (__atomic_compare_exchange_n(&arena->readers[i].in_use, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return &arena->readers[i];
+	}
+	PRINT("There is no free reader slot");
+	return NULL;
+}
+
+void ea_unregister_reader(EpochReader *reader)
+{
+	M_ASSERT(reader != NULL, "Epoch Reader is NULL");
+	M_ASSERT(reader->epoch == 0, "Reader is inside critical section");
+	__atomic_store_n(&reader->in_use, 0, __ATOMIC_RELEASE);
+}
+
+// writer that hasn't seen this slot yet published before the root is loaded
+void *ea_read_lock(EpochArena *arena, EpochReader *reader)
+{
+	__atomic_store_n(&reader->epoch, __atomic_load_n(&arena->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+	return __atomic_load_n(&arena->root, __ATOMIC_SEQ_CST);
+}
+
+void ea_read_unlock(EpochReader *reader)
+{
+	__atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+const size_t ea_num_of_generations(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	return arena->num_of_generations;
+}
+
+const size_t ea_retired_generations(EpochArena *arena)
+{
+	M_ASSERT(arena != NULL, "Epoch Arena is NULL");
+	size_t retired = 0;
+	for (size_t i = 0; i < arena->num_of_generations; i++)
+		retired += arena->generations[i].state == GENERATION_RETIRED;
+	return retired;
+}
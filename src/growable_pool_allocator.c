@@ -0,0 +1,352 @@
+#include "../include/growable_pool_allocator.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/memory.h"				// ALIGNED_SIZE, ALIGN_POINTER_DOWN, DEFAULT_ALIGNMENT
+#include "../include/virtual_memory.h"			// vm_map_aligned, vm_release, vm_page_size
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include "../include/owner_registry.h"			// owner_register, owner_unregister
+#include "../include/memory_provider.h"		// mp_acquire, mp_release
+
+// lives at the start of every slab
+struct Slab
+{
+	struct Slab *prev;
+	struct Slab *next;
+	char *freelist;					// freed elements
+	char *unused;					// elements that were never handed out start here
+	size_t used;
+};							// 40 bytes
+
+// slabs picked by gpa_init hold at least this many elements
+#define MIN_ELEMENTS_PER_SLAB		8
+
+// free element keeps address of the next one at link_offset
+#define ELEMENT_LINK(allocator, element)	(*(char **)((element) + (allocator)->link_offset))
+
+static void slab_push(struct Slab **list, struct Slab *slab)
+{
+	slab->prev = NULL;
+	slab->next = *list;
+	if (*list != NULL)
+		(*list)->prev = slab;
+	*list = slab;
+}
+
+static void slab_remove(struct Slab **list, struct Slab *slab)
+{
+	if (slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		*list = slab->next;
+	if (slab->next != NULL)
+		slab->next->prev = slab->prev;
+}
+
+// marks every element free. constructed objects are linked into free list at once,
+// plain elements are carved from the unused tail on demand
+static void slab_clear(GrowablePoolAllocator *allocator, struct Slab *slab)
+{
+	char *element	= (char *)slab + allocator->elements_offset;
+	slab->freelist	= NULL;
+	slab->unused	= element;
+	slab->used		= 0;
+	if (allocator->constructor == NULL)
+		return;
+
+	char **link = &slab->freelist;
+	for (size_t i = 0; i < allocator->elements_per_slab; i++, element += allocator->element_size)
+	{
+		*link = element;
+		link = &ELEMENT_LINK(allocator, element);
+	}
+	*link = NULL;
+	slab->unused = element;
+}
+
+// objects are constructed only here, when slab is mapped
+static struct Slab *slab_create(GrowablePoolAllocator *allocator)
+{
+	struct Slab *slab = (allocator->provider != NULL)
+		? mp_acquire(allocator->provider, allocator->slab_size, allocator->slab_size)
+		: vm_map_aligned(allocator->slab_size, allocator->slab_size);
+	if (slab == NULL)
+		return NULL;
+
+	if (allocator->constructor != NULL)
+	{
+		char *element = (char *)slab + allocator->elements_offset;
+		for (size_t i = 0; i < allocator->elements_per_slab; i++, element += allocator->element_size)
+			allocator->constructor(element, allocator->context);
+	}
+	slab_clear(allocator, slab);
+	owner_register(allocator, ALLOCATOR_GROWABLE_POOL, slab, (char *)slab + allocator->slab_size);
+	allocator->num_of_slabs++;
+	return slab;
+}
+
+// and destroyed only here, when slab is unmapped
+static void slab_destroy(GrowablePoolAllocator *allocator, struct Slab *slab)
+{
+	if (allocator->destructor != NULL)
+		for (char *element = (char *)slab + allocator->elements_offset; element < slab->unused; element += allocator->element_size)
+			allocator->destructor(element, allocator->context);
+	owner_unregister(allocator, slab);
+	if (allocator->provider != NULL)
+		mp_release(allocator->provider, slab, allocator->slab_size);
+	else
+		vm_release(slab, allocator->slab_size);
+	allocator->num_of_slabs--;
+}
+
+static void slab_destroy_list(GrowablePoolAllocator *allocator, struct Slab *list)
+{
+	while (list != NULL)
+	{
+		struct Slab *next = list->next;
+		slab_destroy(allocator, list);
+		list = next;
+	}
+}
+
+// empty slab is cached or unmapped
+static void slab_retire(GrowablePoolAllocator *allocator, struct Slab *slab)
+{
+	if (allocator->num_of_empty_slabs < allocator->max_empty_slabs)
+	{
+		slab_clear(allocator, slab);
+		slab_push(&allocator->empty, slab);
+		allocator->num_of_empty_slabs++;
+		return;
+	}
+	slab_destroy(allocator, slab);
+}
+
+void gpa_init_aligned(GrowablePoolAllocator *allocator, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
+	M_ASSERT((slab_size & (slab_size - 1)) == 0, "Slab size is not a power of two");
+
+	// free element keeps address of the next one
+	ASSERT(alignment >= DEFAULT_ALIGNMENT);
+
+	allocator->element_size		= ALIGNED_SIZE(element_size, alignment);
+	allocator->elements_offset	= ALIGNED_SIZE(sizeof(struct Slab), alignment);
+
+	// slab must be page aligned and hold a few elements
+	size_t size = slab_size ? slab_size : DEFAULT_SLAB_SIZE;
+	if (size < vm_page_size())
+		size = vm_page_size();
+	while (slab_size == 0 && allocator->elements_offset + MIN_ELEMENTS_PER_SLAB * allocator->element_size > size)
+		size <<= 1;
+	M_ASSERT(allocator->elements_offset + allocator->element_size <= size, "Slab can't fit an element");
+
+	allocator->slab_size			= size;
+	allocator->elements_per_slab	= (size - allocator->elements_offset) / allocator->element_size;
+	allocator->max_empty_slabs		= max_empty_slabs;
+	allocator->num_of_empty_slabs	= 0;
+	allocator->num_of_slabs			= 0;
+	allocator->link_offset			= 0;
+	allocator->constructor			= NULL;
+	allocator->destructor			= NULL;
+	allocator->context				= NULL;
+	allocator->provider				= NULL;
+	allocator->current = allocator->partial = allocator->full = allocator->empty = NULL;
+}
+
+void gpa_init(GrowablePoolAllocator *allocator, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs)
+{
+	gpa_init_aligned(allocator, element_size, slab_size, max_empty_slabs, DEFAULT_ALIGNMENT);
+}
+
+void gpa_init_from(GrowablePoolAllocator *allocator, MemoryProvider *provider, const size_t element_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment)
+{
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	gpa_init_aligned(allocator, element_size, slab_size, max_empty_slabs, alignment);
+	allocator->provider = provider;
+}
+
+void gpa_init_cache(GrowablePoolAllocator *allocator, const size_t object_size, const size_t slab_size, const size_t max_empty_slabs, const size_t alignment,
+		    const size_t link_offset, ObjectHook constructor, ObjectHook destructor, void *context)
+{
+	M_ASSERT(link_offset == GPA_LINK_OUTSIDE || (link_offset % sizeof(char *) == 0 && link_offset + sizeof(char *) <= object_size),
+		"Link field is not a pointer-sized field of the object");
+
+	// link outside takes a word after the object
+	const size_t offset = (link_offset == GPA_LINK_OUTSIDE) ? ALIGNED_SIZE(object_size, sizeof(char *)) : link_offset;
+	const size_t element_size = (link_offset == GPA_LINK_OUTSIDE) ? offset + sizeof(char *) : object_size;
+
+	gpa_init_aligned(allocator, element_size, slab_size, max_empty_slabs, alignment);
+	allocator->link_offset	= offset;
+	allocator->constructor	= constructor;
+	allocator->destructor	= destructor;
+	allocator->context		= context;
+}
+
+// current slab is exhausted: continue in the fullest partial slab, then in cached one, then in a new one
+static NOINLINE struct Slab *gpa_next_slab(GrowablePoolAllocator *allocator)
+{
+	if (allocator->current != NULL)
+		slab_push(&allocator->full, allocator->current);
+	allocator->current = NULL;
+
+	struct Slab *slab = allocator->partial;
+	for (struct Slab *iterator = allocator->partial; iterator != NULL; iterator = iterator->next)
+		if (iterator->used > slab->used)
+			slab = iterator;
+
+	if (slab != NULL)
+		slab_remove(&allocator->partial, slab);
+	else if ((slab = allocator->empty) != NULL)
+	{
+		slab_remove(&allocator->empty, slab);
+		allocator->num_of_empty_slabs--;
+	}
+	else if ((slab = slab_create(allocator)) == NULL)
+	{
+		PRINT("There is no available space");
+		return NULL;
+	}
+
+	allocator->current = slab;
+	return slab;
+}
+
+void *gpa_alloc(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	struct Slab *slab = allocator->current;
+	if (UNLIKELY(slab == NULL || slab->used == allocator->elements_per_slab) && (slab = gpa_next_slab(allocator)) == NULL)
+		return NULL;
+
+	char *ptr;
+	if (slab->freelist != NULL)
+	{
+		ptr = slab->freelist;
+		slab->freelist = ELEMENT_LINK(allocator, ptr);
+	}
+	else
+	{
+		ptr = slab->unused;
+		slab->unused += allocator->element_size;
+	}
+	slab->used++;
+	TRACE_ALLOC(ALLOCATOR_GROWABLE_POOL, allocator, ptr, allocator->element_size, 0);
+	return ptr;
+}
+
+void gpa_free(GrowablePoolAllocator *allocator, void *ptr)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+#ifdef IGNORE_NULL
+	if (ptr == NULL)
+		return;
+#else
+	ASSERT(ptr != NULL);
+#endif
+	struct Slab *slab = (struct Slab *)ALIGN_POINTER_DOWN(ptr, allocator->slab_size);
+	M_ASSERT((char *)ptr >= (char *)slab + allocator->elements_offset && (char *)ptr < slab->unused, "Pointer is not an element of this pool");
+	TRACE_FREE(ALLOCATOR_GROWABLE_POOL, allocator, ptr);
+
+	ELEMENT_LINK(allocator, (char *)ptr) = slab->freelist;
+	slab->freelist = (char *)ptr;
+
+	// current slab stays where it is even when empty
+	if (slab == allocator->current)
+	{
+		slab->used--;
+		return;
+	}
+
+	if (slab->used-- == allocator->elements_per_slab)
+	{
+		slab_remove(&allocator->full, slab);
+		if (slab->used != 0)
+		{
+			slab_push(&allocator->partial, slab);
+			return;
+		}
+	}
+	else if (slab->used == 0)
+		slab_remove(&allocator->partial, slab);
+	else
+		return;
+
+	slab_retire(allocator, slab);
+}
+
+void gpa_reset(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	TRACE_RESET(ALLOCATOR_GROWABLE_POOL, allocator);
+
+	struct Slab *lists[] = { allocator->partial, allocator->full };
+	allocator->partial = allocator->full = NULL;
+	if (allocator->current != NULL)
+	{
+		slab_retire(allocator, allocator->current);
+		allocator->current = NULL;
+	}
+
+	for (int i = 0; i < 2; i++)
+		while (lists[i] != NULL)
+		{
+			struct Slab *next = lists[i]->next;
+			slab_retire(allocator, lists[i]);
+			lists[i] = next;
+		}
+}
+
+void gpa_terminate(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	TRACE_RESET(ALLOCATOR_GROWABLE_POOL, allocator);
+
+	if (allocator->current != NULL)
+		slab_destroy(allocator, allocator->current);
+	slab_destroy_list(allocator, allocator->partial);
+	slab_destroy_list(allocator, allocator->full);
+	slab_destroy_list(allocator, allocator->empty);
+
+	allocator->current = allocator->partial = allocator->full = allocator->empty = NULL;
+	allocator->num_of_empty_slabs = 0;
+}
+
+const size_t gpa_num_of_slabs(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	return allocator->num_of_slabs;
+}
+
+const size_t gpa_used_elements(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	size_t used = allocator->current ? allocator->current->used : 0;
+	for (struct Slab *slab = allocator->partial; slab != NULL; slab = slab->next)
+		used += slab->used;
+	for (struct Slab *slab = allocator->full; slab != NULL; slab = slab->next)
+		used += slab->used;
+	return used;
+}
+
+void gpa_show_slabs(GrowablePoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Growable Pool Allocator is NULL");
+	PRINT("Slabs of GrowablePoolAllocator (used elements):");
+	if (allocator->current != NULL)
+		fprintf(stdout, "  current " HEX_FORMAT ": " UINT_FORMAT "\n", (size_t)allocator->current, allocator->current->used);
+	for (struct Slab *slab = allocator->partial; slab != NULL; slab = slab->next)
+		fprintf(stdout, "  partial " HEX_FORMAT ": " UINT_FORMAT "\n", (size_t)slab, slab->used);
+	for (struct Slab *slab = allocator->full; slab != NULL; slab = slab->next)
+		fprintf(stdout, "  full    " HEX_FORMAT ": " UINT_FORMAT "\n", (size_t)slab, slab->used);
+	for (struct Slab *slab = allocator->empty; slab != NULL; slab = slab->next)
+		fprintf(stdout, "  empty   " HEX_FORMAT "\n", (size_t)slab);
+}
+
+void gpa_show_all_info(GrowablePoolAllocator *allocator)
+{
+	PRINT_UINT(allocator->element_size);
+	PRINT_UINT(allocator->elements_per_slab);
+	PRINT_UINT(gpa_num_of_slabs(allocator));
+	PRINT_UINT(gpa_used_elements(allocator));
+	gpa_show_slabs(allocator);
+}
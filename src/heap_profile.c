@@ -0,0 +1,272 @@
+#include "../include/heap_profile.h"
+#include "../include/allocation_trace.h"	// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include "../debug/debug.h"			// M_ASSERT, PRINT
+#include <execinfo.h>				// backtrace, backtrace_symbols
+#include <pthread.h>				// pthread_mutex_lock
+#include <stdint.h>				// uint64_t, uintptr_t
+#include <stdio.h>				// fopen, fprintf, fclose
+#include <stdlib.h>				// malloc, free
+#include <string.h>				// strchr, strlen
+#include <time.h>				// clock_gettime
+
+// power of two
+#define SAMPLE_BUCKETS		4096
+
+// heap_profile_record and take_sample
+#define SKIPPED_FRAMES		2
+
+struct Sample
+{
+	const void *allocator;
+	const void *ptr;
+	size_t size;
+	size_t weight;				// bytes of allocations this sample stands for
+	AllocatorKind kind;
+	int depth;
+	void *frames[HEAP_PROFILE_MAX_DEPTH];
+	struct Sample *next;
+};
+
+int heap_profile_enabled = 0;
+
+static size_t sample_interval = DEFAULT_SAMPLE_INTERVAL;
+static pthread_mutex_t samples_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct Sample *samples[SAMPLE_BUCKETS];
+static size_t num_of_samples = 0;
+
+static _Thread_local size_t bytes_until_sample = 0;
+static _Thread_local uint64_t random_state = 0;
+
+static const char *kind_names[ALLOCATOR_KIND_COUNT] =
+{
+	"LinearAllocator", "StackAllocator", "PoolAllocator", "DoubleBufferedAllocator",
+	"DoubleEndedStackAllocator", "SharedPoolAllocator", "GrowablePoolAllocator"
+};
+
+static size_t bucket_of(const void *ptr)
+{
+	return (size_t)(((uintptr_t)ptr * 0x9E3779B97F4A7C15ULL) >> 52) & (SAMPLE_BUCKETS - 1);
+}
+
+// exponential distribution keeps sampling memoryless, so allocation pattern can't dodge it.
+// -ln(u) with log2 interpolated linearly between powers of two, close enough for a distance
+static size_t next_distance(void)
+{
+	if (random_state == 0)
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		random_state = ((uint64_t)(uintptr_t)&random_state ^ (uint64_t)now.tv_nsec) | 1;
+	}
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+
+	const uint64_t random = (random_state >> 38) + 1;	// 1 .. 2^26
+	const int exponent = 63 - __builtin_clzll(random);
+	const double log2_random = exponent + (double)(random - ((uint64_t)1 << exponent)) / (double)((uint64_t)1 << exponent);
+	return (size_t)((26 - log2_random) * 0.6931471805599453 * (double)sample_interval) + 1;
+}
+
+// e^-x without libm: Taylor series for x / 1024 squared ten times
+static double exp_minus(const double x)
+{
+	const double y = x / 1024;
+	double result = 1 - y * (1 - y / 2 * (1 - y / 3 * (1 - y / 4)));
+	for (int i = 0; i < 10; i++)
+		result *= result;
+	return result;
+}
+
+// allocation of 'size' bytes is sampled with probability 1 - e^(-size / interval)
+static size_t weight_of(const size_t size)
+{
+	const double x = (double)size / (double)sample_interval;
+	if (x > 64)
+		return size;
+	return (size_t)((double)size / (1 - exp_minus(x)));
+}
+
+static NOINLINE void take_sample(const AllocatorKind kind, const void *allocator, const void *ptr, const size_t size)
+{
+	struct Sample *sample = malloc(sizeof(struct Sample));
+	if (sample == NULL)
+		return;
+
+	sample->allocator	= allocator;
+	sample->ptr		= ptr;
+	sample->size		= size;
+	sample->weight		= weight_of(size);
+	sample->kind		= kind;
+	sample->depth		= backtrace(sample->frames, HEAP_PROFILE_MAX_DEPTH);
+
+	pthread_mutex_lock(&samples_lock);
+	struct Sample **bucket = &samples[bucket_of(ptr)];
+	sample->next = *bucket;
+	*bucket = sample;
+	__atomic_fetch_add(&num_of_samples, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&samples_lock);
+}
+
+// drops samples of 'allocator' in [start, end), called with samples_lock held
+static void drop_samples(const void *allocator, const char *start, const char *end)
+{
+	for (size_t i = 0; i < SAMPLE_BUCKETS; i++)
+	{
+		struct Sample **link = &samples[i];
+		while (*link != NULL)
+		{
+			struct Sample *sample = *link;
+			if (sample->allocator == allocator && (const char *)sample->ptr >= start && (const char *)sample->ptr < end)
+			{
+				*link = sample->next;
+				free(sample);
+				__atomic_fetch_sub(&num_of_samples, 1, __ATOMIC_RELAXED);
+			}
+			else
+				link = &sample->next;
+		}
+	}
+}
+
+void heap_profile_record(const int type, const AllocatorKind kind, const void *allocator, const void *ptr, const size_t size)
+{
+	if (type == TRACE_ALLOC)
+	{
+		if (LIKELY(size < bytes_until_sample))
+		{
+			bytes_until_sample -= size;
+			return;
+		}
+
+		// first allocation of a thread only draws the distance
+		const int first = random_state == 0;
+		bytes_until_sample = next_distance();
+		if (!first && ptr != NULL)
+			take_sample(kind, allocator, ptr, size);
+		return;
+	}
+
+	// nothing to look for, most of the time
+	if (__atomic_load_n(&num_of_samples, __ATOMIC_RELAXED) == 0)
+		return;
+
+	pthread_mutex_lock(&samples_lock);
+	if (type == TRACE_FREE)
+	{
+		for (struct Sample **link = &samples[bucket_of(ptr)]; *link != NULL; link = &(*link)->next)
+		{
+			struct Sample *sample = *link;
+			if (sample->ptr == ptr && sample->allocator == allocator)
+			{
+				*link = sample->next;
+				free(sample);
+				__atomic_fetch_sub(&num_of_samples, 1, __ATOMIC_RELAXED);
+				break;
+			}
+		}
+	}
+	else if (type == TRACE_RESET)
+	{
+		if (ptr == NULL)
+			drop_samples(allocator, NULL, (const char *)UINTPTR_MAX);
+		else
+			drop_samples(allocator, ptr, (const char *)ptr + size);
+	}
+	pthread_mutex_unlock(&samples_lock);
+}
+
+void heap_profile_start(const size_t interval)
+{
+	M_ASSERT(interval > 0, "Sample interval is zero");
+
+	// first backtrace loads unwinder, that must not happen inside allocation path
+	void *frame;
+	backtrace(&frame, 1);
+
+	// hooks that see the flag see the interval
+	sample_interval = interval;
+	__atomic_store_n(&heap_profile_enabled, 1, __ATOMIC_RELEASE);
+}
+
+void heap_profile_stop(void)
+{
+	__atomic_store_n(&heap_profile_enabled, 0, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&samples_lock);
+	for (size_t i = 0; i < SAMPLE_BUCKETS; i++)
+	{
+		while (samples[i] != NULL)
+		{
+			struct Sample *sample = samples[i];
+			samples[i] = sample->next;
+			free(sample);
+		}
+	}
+	__atomic_store_n(&num_of_samples, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&samples_lock);
+}
+
+// "module(function+offset) [address]" -> "function", frames without symbol keep "module(+offset)"
+static void write_frame(FILE *file, const char *symbol)
+{
+	const char *open = strchr(symbol, '(');
+	const char *plus = open != NULL ? strchr(open, '+') : NULL;
+	if (open != NULL && plus != NULL && plus > open + 1)
+		fprintf(file, ";%.*s", (int)(plus - open - 1), open + 1);
+	else
+	{
+		const char *space = strchr(symbol, ' ');
+		fprintf(file, ";%.*s", space != NULL ? (int)(space - symbol) : (int)strlen(symbol), symbol);
+	}
+}
+
+int heap_profile_dump(const char *path)
+{
+	M_ASSERT(path != NULL, "Path is NULL");
+	FILE *file = fopen(path, "w");
+	if (file == NULL)
+	{
+		PRINT("Unable to create heap profile");
+		return 0;
+	}
+
+	// tools add up lines with equal stacks
+	pthread_mutex_lock(&samples_lock);
+	for (size_t i = 0; i < SAMPLE_BUCKETS; i++)
+	{
+		for (struct Sample *sample = samples[i]; sample != NULL; sample = sample->next)
+		{
+			fprintf(file, "%s@%p", kind_names[sample->kind], sample->allocator);
+			char **symbols = backtrace_symbols(sample->frames, sample->depth);
+			for (int frame = sample->depth - 1; frame >= SKIPPED_FRAMES; frame--)
+				write_frame(file, symbols != NULL ? symbols[frame] : "?");
+			fprintf(file, " %zu\n", sample->weight);
+			free(symbols);
+		}
+	}
+	pthread_mutex_unlock(&samples_lock);
+
+	fclose(file);
+	return 1;
+}
+
+const size_t heap_profile_num_of_samples(void)
+{
+	return __atomic_load_n(&num_of_samples, __ATOMIC_RELAXED);
+}
+
+const size_t heap_profile_live_bytes(const void *allocator)
+{
+	size_t bytes = 0;
+	pthread_mutex_lock(&samples_lock);
+	for (size_t i = 0; i < SAMPLE_BUCKETS; i++)
+	{
+		for (struct Sample *sample = samples[i]; sample != NULL; sample = sample->next)
+		{
+			if (allocator == NULL || sample->allocator == allocator)
+				bytes += sample->weight;
+		}
+	}
+	pthread_mutex_unlock(&samples_lock);
+	return bytes;
+}
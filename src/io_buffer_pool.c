@@ -0,0 +1,149 @@
+#include "../include/io_buffer_pool.h"
+#include "../debug/debug.h"			// M_ASSERT, PRINT
+#include "../include/memory.h"			// ALIGNED_SIZE, UNLIKELY
+#include "../include/virtual_memory.h"		// vm_page_size
+#include <stdlib.h>				// malloc, free
+#include <unistd.h>				// read, pread
+
+void iop_init(IoBufferPool *pool, const size_t num_of_buffers, const size_t buffer_size)
+{
+	M_ASSERT(pool != NULL, "I/O Buffer Pool is NULL");
+	M_ASSERT(buffer_size > 0, "Buffer size is zero");
+
+	// page-sized elements on page boundary, each buffer starts on its own page
+	const size_t page_size = vm_page_size();
+	pool->buffer_size	= ALIGNED_SIZE(buffer_size, page_size);
+	pa_init_aligned(&pool->buffers, num_of_buffers, pool->buffer_size, page_size);
+
+	pool->descriptors = malloc(num_of_buffers * sizeof(IoBuffer));
+	if (pool->buffers.start == NULL || pool->descriptors == NULL)
+	{
+		PRINT("Can't allocate memory for I/O Buffer Pool");
+		pa_terminate(&pool->buffers);
+		free(pool->descriptors);
+		pool->descriptors		= NULL;
+		pool->num_of_buffers		= 0;
+		pool->num_of_free_buffers	= 0;
+		return;
+	}
+
+	for (size_t i = 0; i < num_of_buffers; i++)
+	{
+		IoBuffer *buffer = &pool->descriptors[i];
+		buffer->data	= pool->buffers.start + i * pool->buffer_size;
+		buffer->length	= 0;
+		buffer->refs	= 0;
+		buffer->pool	= pool;
+	}
+	pool->num_of_buffers		= num_of_buffers;
+	pool->num_of_free_buffers	= num_of_buffers;
+}
+
+void iop_terminate(IoBufferPool *pool)
+{
+	M_ASSERT(pool != NULL, "I/O Buffer Pool is NULL");
+	if (pool->num_of_free_buffers != pool->num_of_buffers)
+		PRINT("I/O Buffer Pool is terminated with buffers in use");
+
+	pa_terminate(&pool->buffers);
+	free(pool->descriptors);
+	pool->descriptors		= NULL;
+	pool->num_of_buffers		= 0;
+	pool->num_of_free_buffers	= 0;
+}
+
+IoBuffer *iop_acquire(IoBufferPool *pool)
+{
+	M_ASSERT(pool != NULL, "I/O Buffer Pool is NULL");
+	char *data = pa_alloc(&pool->buffers);
+	if (UNLIKELY(data == NULL))
+		return NULL;
+
+	// descriptor is found by position of the buffer
+	IoBuffer *buffer = &pool->descriptors[(size_t)(data - pool->buffers.start) / pool->buffer_size];
+	buffer->length	= 0;
+	buffer->refs	= 1;
+	pool->num_of_free_buffers--;
+	return buffer;
+}
+
+ssize_t iop_read(IoBuffer *buffer, const int fd, const off_t offset)
+{
+	M_ASSERT(buffer != NULL, "I/O Buffer is NULL");
+	M_ASSERT(buffer->refs > 0, "I/O Buffer is released");
+
+	char *free_space	= buffer->data + buffer->length;
+	const size_t space	= buffer->pool->buffer_size - buffer->length;
+	const ssize_t bytes	= offset < 0 ? read(fd, free_space, space) : pread(fd, free_space, space, offset);
+	if (bytes > 0)
+		buffer->length += (size_t)bytes;
+	return bytes;
+}
+
+IoSlice iop_slice(IoBuffer *buffer, const size_t offset, const size_t length)
+{
+	M_ASSERT(buffer != NULL, "I/O Buffer is NULL");
+	M_ASSERT(offset + length <= buffer->length, "Slice is out of buffer");
+	iop_retain(buffer);
+
+	IoSlice slice = { buffer, buffer->data + offset, length };
+	return slice;
+}
+
+IoSlice iop_subslice(const IoSlice *slice, const size_t offset, const size_t length)
+{
+	M_ASSERT(slice != NULL && slice->buffer != NULL, "I/O Slice is empty");
+	M_ASSERT(offset + length <= slice->length, "Slice is out of parent slice");
+	iop_retain(slice->buffer);
+
+	IoSlice subslice = { slice->buffer, slice->data + offset, length };
+	return subslice;
+}
+
+void iop_retain(IoBuffer *buffer)
+{
+	M_ASSERT(buffer != NULL, "I/O Buffer is NULL");
+	M_ASSERT(buffer->refs > 0, "I/O Buffer is released");
+	buffer->refs++;
+}
+
+void iop_release(IoBuffer *buffer)
+{
+#ifdef IGNORE_NULL
+	if (buffer == NULL)
+		return;
+#else
+	ASSERT(buffer != NULL);
+#endif
+	M_ASSERT(buffer->refs > 0, "I/O Buffer is released twice");
+	if (--buffer->refs > 0)
+		return;
+
+	IoBufferPool *pool = buffer->pool;
+	pa_free(&pool->buffers, buffer->data);
+	pool->num_of_free_buffers++;
+}
+
+void iop_release_slice(IoSlice *slice)
+{
+	M_ASSERT(slice != NULL, "I/O Slice is NULL");
+	iop_release(slice->buffer);
+	slice->buffer	= NULL;
+	slice->data	= NULL;
+	slice->length	= 0;
+}
+
+const size_t iop_free_buffers(IoBufferPool *pool)
+{
+	M_ASSERT(pool != NULL, "I/O Buffer Pool is NULL");
+	return pool->num_of_free_buffers;
+}
+
+void iop_show_all_info(IoBufferPool *pool)
+{
+	M_ASSERT(pool != NULL, "I/O Buffer Pool is NULL");
+	PRINT_UINT(pool->buffer_size);
+	PRINT_UINT(pool->num_of_buffers);
+	PRINT_UINT(iop_free_buffers(pool));
+	PRINT_HEX(pool->buffers.start);
+}
@@ -1,7 +1,17 @@
+#define _GNU_SOURCE					// memfd_create
 #include "../include/linear_allocator.h"
 #include "../debug/debug.h"				// M_ASSERT, PRINT
-#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
+#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT, UNLIKELY, NOINLINE
+#include "../include/virtual_memory.h"		// vm_reserve, vm_release, vm_grow_committed, vm_prefault
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include "../include/owner_registry.h"			// owner_register, owner_extend, owner_unregister
+#include "../include/memory_provider.h"		// mp_release, mp_grow_committed
 #include <stdlib.h>					// malloc, free
+#include <stdio.h>					// fopen, fwrite, fclose
+#include <fcntl.h>					// open
+#include <unistd.h>					// close, ftruncate
+#include <sys/mman.h>					// mmap, munmap, memfd_create
+#include <sys/stat.h>					// fstat
 
 void la_init(LinearAllocator *allocator, const size_t total_size)
 {
@@ -9,14 +19,217 @@ void la_init(LinearAllocator *allocator, const size_t total_size)
 	allocator->start	= (char *)malloc(total_size);
 	allocator->end		= allocator->start + total_size;
 	allocator->current	= allocator->start;
+	allocator->committed	= allocator->end;
+	allocator->commit_chunk	= 0;
+	allocator->backing	= MEMORY_HEAP;
+	allocator->fd		= -1;
+	allocator->provider	= NULL;
+	owner_register(allocator, ALLOCATOR_LINEAR, allocator->start, allocator->end);
 	MEMSET_ZERO(allocator->start, total_size);
 }
 
+void la_init_virtual(LinearAllocator *allocator, const size_t total_size, const size_t commit_chunk)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	allocator->start	= (char *)vm_reserve(total_size);
+	// failed reservation leaves the arena empty, every allocation fails
+	allocator->end		= allocator->start ? allocator->start + total_size : NULL;
+	allocator->current	= allocator->start;
+	allocator->committed	= allocator->start;
+	allocator->commit_chunk	= ALIGNED_SIZE(commit_chunk ? commit_chunk : DEFAULT_COMMIT_CHUNK, vm_page_size());
+	allocator->backing	= MEMORY_VIRTUAL;
+	allocator->fd		= -1;
+	allocator->provider	= NULL;
+}
+
+void la_init_from(LinearAllocator *allocator, MemoryProvider *provider, const size_t total_size)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	allocator->start	= (char *)provider->reserve(provider, total_size, DEFAULT_ALIGNMENT);
+	// full buffer or parent leaves the arena empty, every allocation fails
+	allocator->end		= allocator->start ? allocator->start + total_size : NULL;
+	allocator->current	= allocator->start;
+	allocator->committed	= provider->commit ? allocator->start : allocator->end;
+	allocator->commit_chunk	= provider->commit ? ALIGNED_SIZE(DEFAULT_COMMIT_CHUNK, vm_page_size()) : 0;
+	allocator->backing	= MEMORY_PROVIDED;
+	allocator->fd		= -1;
+	allocator->provider	= provider;
+	if (allocator->start != NULL && provider->commit == NULL)
+	{
+		owner_register(allocator, ALLOCATOR_LINEAR, allocator->start, allocator->end);
+		MEMSET_ZERO(allocator->start, total_size);
+	}
+}
+
 void la_terminate(LinearAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
-	free(allocator->start);
-	allocator->current = allocator->start = allocator->end = NULL;
+	TRACE_RESET(ALLOCATOR_LINEAR, allocator);
+	owner_unregister(allocator, allocator->start);
+	if (allocator->backing == MEMORY_HEAP)
+		free(allocator->start);
+	else if (allocator->backing == MEMORY_PROVIDED)
+		mp_release(allocator->provider, allocator->start, (size_t)(allocator->end - allocator->start));
+	else
+		vm_release(allocator->start, (size_t)(allocator->end - allocator->start));
+	if (allocator->fd >= 0)
+		close(allocator->fd);
+	allocator->fd = -1;
+	allocator->provider = NULL;
+	allocator->current = allocator->start = allocator->end = allocator->committed = NULL;
+}
+
+int la_save_snapshot(LinearAllocator *allocator, const char *path)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(path != NULL, "Path is NULL");
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		PRINT("Unable to create snapshot file");
+		return 0;
+	}
+
+	const size_t used_size = (size_t)(allocator->current - allocator->start);
+	const int written = fwrite(allocator->start, 1, used_size, file) == used_size;
+	return (fclose(file) == 0) && written;
+}
+
+int la_load_snapshot(LinearAllocator *allocator, const char *path, const int copy_on_write)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(path != NULL, "Path is NULL");
+
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		PRINT("Unable to open snapshot file");
+		return 0;
+	}
+
+	struct stat file_info;
+	if (fstat(fd, &file_info) != 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	const size_t size = (size_t)file_info.st_size;
+	char *ptr = NULL;
+
+	// empty snapshot can't be mapped, it is just an empty arena
+	if (size != 0)
+	{
+		ptr = mmap(NULL, size, copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED)
+		{
+			PRINT("Unable to map snapshot file");
+			close(fd);
+			return 0;
+		}
+	}
+
+	// mapping keeps the file referenced
+	close(fd);
+
+	allocator->start	= ptr;
+	allocator->end		= ptr + size;
+	allocator->current	= allocator->end;
+	allocator->committed	= allocator->end;
+	allocator->commit_chunk	= 0;
+	allocator->backing	= copy_on_write ? MEMORY_MAPPED_PRIVATE : MEMORY_MAPPED_READ_ONLY;
+	allocator->fd		= -1;
+	allocator->provider	= NULL;
+	owner_register(allocator, ALLOCATOR_LINEAR, allocator->start, allocator->end);
+	return 1;
+}
+
+int la_init_shared(LinearAllocator *allocator, const size_t total_size)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(total_size != 0, "Shared arena is empty");
+
+	// file is sparse, pages appear when they are written
+	const int fd = memfd_create("linear_allocator", MFD_CLOEXEC);
+	if (fd < 0 || ftruncate(fd, (off_t)total_size) != 0)
+	{
+		PRINT("Unable to create memory file");
+		if (fd >= 0)
+			close(fd);
+		return 0;
+	}
+
+	char *ptr = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		PRINT("Unable to map memory file");
+		close(fd);
+		return 0;
+	}
+
+	allocator->start	= ptr;
+	allocator->end		= ptr + total_size;
+	allocator->current	= ptr;
+	allocator->committed	= allocator->end;
+	allocator->commit_chunk	= 0;
+	allocator->backing	= MEMORY_SHARED_FILE;
+	allocator->fd		= fd;
+	allocator->provider	= NULL;
+	owner_register(allocator, ALLOCATOR_LINEAR, allocator->start, allocator->end);
+	return 1;
+}
+
+int la_clone(LinearAllocator *clone, const LinearAllocator *source)
+{
+	M_ASSERT(clone != NULL && source != NULL, "Linear Allocator is NULL");
+	M_ASSERT(source->backing == MEMORY_SHARED_FILE, "Only arena created with la_init_shared can be cloned");
+
+	const size_t total_size = (size_t)(source->end - source->start);
+	char *ptr = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, source->fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		PRINT("Unable to map clone");
+		return 0;
+	}
+
+	clone->start		= ptr;
+	clone->end			= ptr + total_size;
+	clone->current		= ptr + (source->current - source->start);
+	clone->committed	= clone->end;
+	clone->commit_chunk	= 0;
+	clone->backing		= MEMORY_MAPPED_PRIVATE;
+	clone->fd			= -1;
+	clone->provider		= NULL;
+	owner_register(clone, ALLOCATOR_LINEAR, clone->start, clone->end);
+	return 1;
+}
+
+void *la_rebase(const LinearAllocator *to, const LinearAllocator *from, const void *ptr)
+{
+	M_ASSERT(to != NULL && from != NULL, "Linear Allocator is NULL");
+	if (ptr == NULL)
+		return NULL;
+	M_ASSERT((const char *)ptr >= from->start && (const char *)ptr <= from->end, "Pointer is not in arena");
+	return to->start + ((const char *)ptr - from->start);
+}
+
+// moves commit watermark so 'size' bytes fit after current pointer
+static NOINLINE int la_commit(LinearAllocator *allocator, const size_t size)
+{
+	if (allocator->commit_chunk == 0 || size > (size_t)(allocator->end - allocator->current))
+		return 0;
+
+	char *committed = (allocator->backing == MEMORY_VIRTUAL)
+		? vm_grow_committed(allocator->committed, allocator->current + size, allocator->end, allocator->commit_chunk)
+		: mp_grow_committed(allocator->provider, allocator->committed, allocator->current + size, allocator->end, allocator->commit_chunk);
+	if (committed == NULL)
+		return 0;
+
+	allocator->committed = committed;
+	owner_extend(allocator, ALLOCATOR_LINEAR, allocator->start, committed);
+	return 1;
 }
 
 void *la_alloc(LinearAllocator *allocator, const size_t size)
@@ -29,25 +242,59 @@ void *la_alloc_aligned(LinearAllocator *allocator, const size_t size, const size
 	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
 	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
 	
-	const size_t aligned_size = ALIGNED_SIZE(size, alignment);
+	// address itself is aligned, padding goes before the allocation
+	char *ptr = ALIGN_POINTER(allocator->current, alignment);
+	const size_t aligned_size = (size_t)(ptr - allocator->current) + size;
 	
-	void *ptr = allocator->current;
-	allocator->current += aligned_size;
-
-	if (allocator->current >= allocator->end)
+	// heap memory is committed entirely, so only virtual arenas leave the fast path successfully
+	if (UNLIKELY(aligned_size > (size_t)(allocator->committed - allocator->current)) && !la_commit(allocator, aligned_size))
 	{
 		PRINT("There is no available space");
 		return NULL;
 	}
 
+	allocator->current += aligned_size;
+	TRACE_ALLOC(ALLOCATOR_LINEAR, allocator, ptr, size, alignment);
 	return ptr;
 }
 
+int la_resize(LinearAllocator *allocator, void *ptr, const size_t old_size, const size_t new_size)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	if ((char *)ptr + old_size != allocator->current)
+		return 0;
+
+	const size_t extra = (new_size > old_size) ? new_size - old_size : 0;
+	if (UNLIKELY(extra > (size_t)(allocator->committed - allocator->current)) && !la_commit(allocator, extra))
+		return 0;
+
+	allocator->current = (char *)ptr + new_size;
+	TRACE_FREE(ALLOCATOR_LINEAR, allocator, ptr);
+	TRACE_ALLOC(ALLOCATOR_LINEAR, allocator, ptr, new_size, 0);
+	return 1;
+}
+
+int la_prefault(LinearAllocator *allocator, const size_t size)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(allocator->backing != MEMORY_MAPPED_READ_ONLY, "Read-only snapshot can't be prefaulted");
+
+	const size_t remaining = (size_t)(allocator->end - allocator->current);
+	const size_t prefault_size = (size == 0 || size > remaining) ? remaining : size;
+	if (prefault_size > (size_t)(allocator->committed - allocator->current) && !la_commit(allocator, prefault_size))
+		return 0;
+
+	vm_prefault(allocator->current, prefault_size);
+	return 1;
+}
+
 void la_reset(LinearAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	M_ASSERT(allocator->backing != MEMORY_MAPPED_READ_ONLY, "Read-only snapshot can't be reset");
+	TRACE_RESET(ALLOCATOR_LINEAR, allocator);
 	allocator->current = allocator->start;
-	MEMSET_ZERO(allocator->start, (const size_t)(allocator->end - allocator->start));
+	MEMSET_ZERO(allocator->start, (const size_t)(allocator->committed - allocator->start));
 }
 
 const size_t la_used_space(LinearAllocator *allocator)
@@ -62,12 +309,18 @@ const size_t la_remaining_space(LinearAllocator *allocator)
 	return (const size_t)(allocator->end - allocator->current);
 }
 
+const size_t la_committed_space(LinearAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
+	return (const size_t)(allocator->committed - allocator->start);
+}
+
 void la_show_memory(LinearAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Linear Allocator is NULL");
 	PRINT("Memory occupied by LinearAllocator:");
-	PRINT_UINT((const size_t)(allocator->end - allocator->start));
-	show_memory(allocator->start, (const size_t)(allocator->end - allocator->start));
+	PRINT_UINT((const size_t)(allocator->committed - allocator->start));
+	show_memory(allocator->start, (const size_t)(allocator->committed - allocator->start));
 }
 
 void la_show_all_info(LinearAllocator *allocator)
@@ -75,4 +328,4 @@ void la_show_all_info(LinearAllocator *allocator)
 	PRINT_UINT(la_used_space(allocator));
 	PRINT_UINT(la_remaining_space(allocator));
 	la_show_memory(allocator);
-}
\ No newline at end of file
+}
@@ -0,0 +1,201 @@
+#include "../include/memory_provider.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/memory.h"				// ALIGNED_SIZE, ALIGN_POINTER
+#include "../include/virtual_memory.h"			// vm_reserve, vm_commit, vm_release, vm_map_aligned, vm_page_size
+#include "../include/linear_allocator.h"		// la_alloc_aligned
+#include "../include/stack_allocator.h"		// sa_alloc_aligned, sa_free
+#include "../include/double_ended_stack_allocator.h"	// desa_front_alloc_aligned, desa_front_free
+#include "../include/double_buffered_allocator.h"	// dba_alloc_aligned
+#include <stdlib.h>					// malloc, posix_memalign, free
+
+static void provider_clear(MemoryProvider *provider)
+{
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	provider->reserve	= NULL;
+	provider->commit	= NULL;
+	provider->release	= NULL;
+	provider->context	= NULL;
+	provider->current	= provider->end = NULL;
+}
+
+// MALLOC
+static void *malloc_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	// malloc alignment is enough only up to two pointers
+	void *ptr = NULL;
+	if (alignment <= 2 * sizeof(void *))
+		ptr = malloc(size);
+	else if (posix_memalign(&ptr, alignment, size) != 0)
+		ptr = NULL;
+	return ptr;
+}
+
+static void malloc_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	free(ptr);
+}
+
+void mp_init_malloc(MemoryProvider *provider)
+{
+	provider_clear(provider);
+	provider->reserve	= malloc_reserve;
+	provider->release	= malloc_release;
+}
+
+// MMAP
+static void *mmap_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	if (alignment <= vm_page_size())
+		return vm_reserve(size);
+	return vm_map_aligned(size, alignment);
+}
+
+static int mmap_commit(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	return vm_commit(ptr, size);
+}
+
+static void mmap_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	vm_release(ptr, size);
+}
+
+void mp_init_mmap(MemoryProvider *provider)
+{
+	provider_clear(provider);
+	provider->reserve	= mmap_reserve;
+	provider->commit	= mmap_commit;
+	provider->release	= mmap_release;
+}
+
+// BUFFER
+static void *buffer_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	char *ptr = ALIGN_POINTER(provider->current, alignment);
+	if (ptr > provider->end || size > (size_t)(provider->end - ptr))
+	{
+		PRINT("There is no available space in buffer");
+		return NULL;
+	}
+	provider->current = ptr + size;
+	return ptr;
+}
+
+static void buffer_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	if ((char *)ptr + size == provider->current)
+		provider->current = (char *)ptr;
+}
+
+void mp_init_buffer(MemoryProvider *provider, void *buffer, const size_t size)
+{
+	M_ASSERT(buffer != NULL, "Buffer is NULL");
+	provider_clear(provider);
+	provider->reserve	= buffer_reserve;
+	provider->release	= buffer_release;
+	provider->current	= (char *)buffer;
+	provider->end		= (char *)buffer + size;
+}
+
+// PARENT ALLOCATORS
+static void *linear_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	return la_alloc_aligned((LinearAllocator *)provider->context, size, alignment);
+}
+
+static void *stack_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	return sa_alloc_aligned((StackAllocator *)provider->context, size, alignment);
+}
+
+static void stack_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	sa_free((StackAllocator *)provider->context, ptr);
+}
+
+static void *double_ended_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	return desa_front_alloc_aligned((DoubleEndedStackAllocator *)provider->context, size, alignment);
+}
+
+static void double_ended_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	desa_front_free((DoubleEndedStackAllocator *)provider->context, ptr);
+}
+
+static void *double_buffered_reserve(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	return dba_alloc_aligned((DoubleBufferedAllocator *)provider->context, size, alignment);
+}
+
+void mp_init_parent(MemoryProvider *provider, const AllocatorKind kind, void *parent)
+{
+	M_ASSERT(parent != NULL, "Parent allocator is NULL");
+	provider_clear(provider);
+	provider->context = parent;
+	switch (kind)
+	{
+		case ALLOCATOR_LINEAR:
+			provider->reserve = linear_reserve;
+			break;
+		case ALLOCATOR_STACK:
+			provider->reserve = stack_reserve;
+			provider->release = stack_release;
+			break;
+		case ALLOCATOR_DOUBLE_ENDED:
+			provider->reserve = double_ended_reserve;
+			provider->release = double_ended_release;
+			break;
+		case ALLOCATOR_DOUBLE_BUFFERED:
+			// child lives until the frame is dropped by a swap
+			provider->reserve = double_buffered_reserve;
+			break;
+		default:
+			M_ASSERT(0, "Pools can't be parents, their elements have fixed size");
+			break;
+	}
+}
+
+void *mp_acquire(MemoryProvider *provider, const size_t size, const size_t alignment)
+{
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
+	void *ptr = provider->reserve(provider, size, alignment);
+	if (ptr == NULL)
+	{
+		PRINT("Unable to reserve memory");
+		return NULL;
+	}
+	if (provider->commit != NULL && !provider->commit(provider, ptr, size))
+	{
+		PRINT("Unable to commit memory");
+		mp_release(provider, ptr, size);
+		return NULL;
+	}
+	return ptr;
+}
+
+void mp_release(MemoryProvider *provider, void *ptr, const size_t size)
+{
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	if (ptr != NULL && provider->release != NULL)
+		provider->release(provider, ptr, size);
+}
+
+char *mp_grow_committed(MemoryProvider *provider, char *committed, const char *required, const char *end, const size_t commit_chunk)
+{
+	M_ASSERT(commit_chunk != 0, "Commit chunk is zero");
+	if (required > end)
+		return NULL;
+
+	char *new_committed = committed + ALIGNED_SIZE((size_t)(required - committed), commit_chunk);
+	if (new_committed > end)
+		new_committed = (char *)end;
+
+	if (!provider->commit(provider, committed, (size_t)(new_committed - committed)))
+	{
+		PRINT("Unable to commit memory");
+		return NULL;
+	}
+	return new_committed;
+}
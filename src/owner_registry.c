@@ -0,0 +1,352 @@
+#include "../include/owner_registry.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/virtual_memory.h"			// vm_map_aligned, vm_page_size
+#include "../include/stack_allocator.h"		// sa_free
+#include "../include/pool_allocator.h"			// pa_free
+#include "../include/double_ended_stack_allocator.h"	// desa_front_free, desa_back_free
+#include "../include/shared_pool_allocator.h"		// spa_free
+#include "../include/growable_pool_allocator.h"	// gpa_free
+#include <stdatomic.h>					// atomic_load_explicit, atomic_store_explicit
+#include <stdint.h>					// uintptr_t
+#include <stdlib.h>					// malloc
+#include <pthread.h>					// pthread_mutex_lock, pthread_mutex_unlock
+
+#define ADDRESS_BITS			48
+#define PAGE_SHIFT				12
+#define LEAF_BITS				18
+#define ROOT_BITS				(ADDRESS_BITS - PAGE_SHIFT - LEAF_BITS)
+#define LEAF_SIZE				((size_t)1 << LEAF_BITS)
+
+#define PAGE_OF(ptr)			((uintptr_t)(ptr) >> PAGE_SHIFT)
+
+// page entry: 0 - no owner, record - the only owner, share list | SHARED_PAGE - page is split between owners
+#define SHARED_PAGE				((uintptr_t)1)
+
+struct OwnerRecord
+{
+	void *allocator;
+	AllocatorKind kind;
+	const char *start;
+	const char *end;
+	struct OwnerRecord *next_free;
+};
+
+// pages on range boundaries may belong to a few allocators (malloc'ed blocks of small arenas),
+// child arenas share every page with their parent. the latest registrant is the head of the list
+struct PageShare
+{
+	struct OwnerRecord *record;
+	struct PageShare *next;
+};
+
+typedef _Atomic uintptr_t PageEntry;
+
+// lookups take no lock: entries and share lists are published with release stores under lock.
+// records and shares are recycled instead of freed, so a lookup that raced with unregister
+// reads memory that is still valid, at worst misses and looks again under lock
+static PageEntry *_Atomic root[(size_t)1 << ROOT_BITS];
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct OwnerRecord *free_records;
+static struct PageShare *free_shares;
+
+// lock-free walk gives up on longer lists, they can only come from a race with recycling
+#define MAX_SHARE_STEPS			64
+
+static PageEntry *page_entry(const uintptr_t page, const int create)
+{
+	M_ASSERT((page >> (LEAF_BITS + ROOT_BITS)) == 0, "Address is beyond page map");
+	PageEntry *leaf = atomic_load_explicit(&root[page >> LEAF_BITS], memory_order_acquire);
+	if (leaf == NULL && create)
+	{
+		// zero-filled, untouched parts of it take no memory
+		leaf = vm_map_aligned(LEAF_SIZE * sizeof(PageEntry), vm_page_size());
+		if (leaf == NULL)
+			return NULL;
+		atomic_store_explicit(&root[page >> LEAF_BITS], leaf, memory_order_release);
+	}
+	return (leaf == NULL) ? NULL : &leaf[page & (LEAF_SIZE - 1)];
+}
+
+// called under lock
+static struct OwnerRecord *record_new(void *allocator, const AllocatorKind kind, const void *start, const void *end)
+{
+	struct OwnerRecord *record = free_records;
+	if (record != NULL)
+		free_records = record->next_free;
+	else if ((record = malloc(sizeof(struct OwnerRecord))) == NULL)
+		return NULL;
+
+	// recycled record may still be read by a lookup
+	__atomic_store_n(&record->allocator, allocator, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->kind, kind, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->start, (const char *)start, __ATOMIC_RELAXED);
+	__atomic_store_n(&record->end, (const char *)end, __ATOMIC_RELAXED);
+	return record;
+}
+
+// called under lock
+static struct PageShare *share_new(struct OwnerRecord *record, struct PageShare *next)
+{
+	struct PageShare *share = free_shares;
+	if (share != NULL)
+		free_shares = share->next;
+	else if ((share = malloc(sizeof(struct PageShare))) == NULL)
+		return NULL;
+
+	__atomic_store_n(&share->record, record, __ATOMIC_RELAXED);
+	__atomic_store_n(&share->next, next, __ATOMIC_RELAXED);
+	return share;
+}
+
+// called under lock, 'share' may still be read by a lookup
+static void share_retire(struct PageShare *share)
+{
+	__atomic_store_n(&share->next, free_shares, __ATOMIC_RELAXED);
+	free_shares = share;
+}
+
+// fields may be rewritten by recycling and end is moved by owner_extend while lookups read them
+static void *record_owner(const struct OwnerRecord *record, const void *ptr, AllocatorKind *kind)
+{
+	if (record == NULL
+		|| (const char *)ptr < __atomic_load_n(&record->start, __ATOMIC_RELAXED)
+		|| (const char *)ptr >= __atomic_load_n(&record->end, __ATOMIC_ACQUIRE))
+		return NULL;
+	*kind = __atomic_load_n(&record->kind, __ATOMIC_RELAXED);
+	return __atomic_load_n(&record->allocator, __ATOMIC_RELAXED);
+}
+
+// called under lock
+static void page_add(const uintptr_t page, struct OwnerRecord *record)
+{
+	PageEntry *entry = page_entry(page, 1);
+	if (entry == NULL)
+	{
+		PRINT("Unable to map page map leaf");
+		return;
+	}
+
+	const uintptr_t value = atomic_load_explicit(entry, memory_order_relaxed);
+	if (value == 0)
+	{
+		atomic_store_explicit(entry, (uintptr_t)record, memory_order_release);
+		return;
+	}
+	if (value == (uintptr_t)record)
+		return;
+
+	struct PageShare *list = (struct PageShare *)(value & ~SHARED_PAGE);
+	if ((value & SHARED_PAGE) == 0)
+	{
+		list = share_new((struct OwnerRecord *)value, NULL);
+		if (list == NULL)
+		{
+			PRINT("Unable to share page");
+			return;
+		}
+	}
+	else
+		for (struct PageShare *share = list; share != NULL; share = share->next)
+			if (share->record == record)
+				return;
+
+	struct PageShare *share = share_new(record, list);
+	if (share == NULL)
+	{
+		// the page keeps its owners, new list wasn't published yet
+		PRINT("Unable to share page");
+		if ((value & SHARED_PAGE) == 0)
+			share_retire(list);
+		return;
+	}
+	atomic_store_explicit(entry, (uintptr_t)share | SHARED_PAGE, memory_order_release);
+}
+
+// called under lock
+static void page_remove(const uintptr_t page, struct OwnerRecord *record)
+{
+	PageEntry *entry = page_entry(page, 0);
+	if (entry == NULL)
+		return;
+
+	const uintptr_t value = atomic_load_explicit(entry, memory_order_relaxed);
+	if (value == (uintptr_t)record)
+	{
+		atomic_store_explicit(entry, 0, memory_order_release);
+		return;
+	}
+	if ((value & SHARED_PAGE) == 0)
+		return;
+
+	struct PageShare *list = (struct PageShare *)(value & ~SHARED_PAGE);
+	for (struct PageShare **link = &list; *link != NULL; link = &(*link)->next)
+		if ((*link)->record == record)
+		{
+			struct PageShare *share = *link;
+			__atomic_store_n(link, share->next, __ATOMIC_RELEASE);
+			share_retire(share);
+			break;
+		}
+
+	// the only owner left gets the page back
+	if (list != NULL && list->next == NULL)
+	{
+		atomic_store_explicit(entry, (uintptr_t)list->record, memory_order_release);
+		share_retire(list);
+	}
+	else
+		atomic_store_explicit(entry, (list == NULL) ? 0 : (uintptr_t)list | SHARED_PAGE, memory_order_release);
+}
+
+// called under lock
+static struct OwnerRecord *find_record(void *allocator, const void *start)
+{
+	PageEntry *entry = page_entry(PAGE_OF(start), 0);
+	if (entry == NULL)
+		return NULL;
+
+	const uintptr_t value = atomic_load_explicit(entry, memory_order_relaxed);
+	if ((value & SHARED_PAGE) == 0)
+	{
+		struct OwnerRecord *record = (struct OwnerRecord *)value;
+		return (record != NULL && record->allocator == allocator && record->start == start) ? record : NULL;
+	}
+
+	for (struct PageShare *share = (struct PageShare *)(value & ~SHARED_PAGE); share != NULL; share = share->next)
+		if (share->record->allocator == allocator && share->record->start == start)
+			return share->record;
+	return NULL;
+}
+
+// the first record that contains 'ptr' is the innermost one
+static void *find_owner(PageEntry *entry, const void *ptr, AllocatorKind *kind, size_t steps)
+{
+	const uintptr_t value = atomic_load_explicit(entry, memory_order_acquire);
+	if (LIKELY((value & SHARED_PAGE) == 0))
+		return record_owner((const struct OwnerRecord *)value, ptr, kind);
+
+	for (const struct PageShare *share = (const struct PageShare *)(value & ~SHARED_PAGE); share != NULL && steps-- != 0;
+		share = __atomic_load_n(&share->next, __ATOMIC_ACQUIRE))
+	{
+		void *allocator = record_owner(__atomic_load_n(&share->record, __ATOMIC_RELAXED), ptr, kind);
+		if (allocator != NULL)
+			return allocator;
+	}
+	return NULL;
+}
+
+void owner_register(void *allocator, const AllocatorKind kind, const void *start, const void *end)
+{
+	if (start == NULL || start >= end)
+		return;
+
+	pthread_mutex_lock(&registry_lock);
+	struct OwnerRecord *record = record_new(allocator, kind, start, end);
+	if (record == NULL)
+		PRINT("Unable to register allocator");
+	else
+		for (uintptr_t page = PAGE_OF(start); page <= PAGE_OF((const char *)end - 1); page++)
+			page_add(page, record);
+	pthread_mutex_unlock(&registry_lock);
+}
+
+void owner_extend(void *allocator, const AllocatorKind kind, const void *start, const void *end)
+{
+	pthread_mutex_lock(&registry_lock);
+	struct OwnerRecord *record = find_record(allocator, start);
+	if (record == NULL)
+	{
+		pthread_mutex_unlock(&registry_lock);
+		owner_register(allocator, kind, start, end);
+		return;
+	}
+
+	// new end is published before the pages, so lookup that finds the record on them sees it
+	const char *old_end = record->end;
+	if ((const char *)end > old_end)
+	{
+		__atomic_store_n(&record->end, (const char *)end, __ATOMIC_RELEASE);
+		for (uintptr_t page = PAGE_OF(old_end); page <= PAGE_OF((const char *)end - 1); page++)
+			page_add(page, record);
+	}
+	pthread_mutex_unlock(&registry_lock);
+}
+
+void owner_unregister(void *allocator, const void *start)
+{
+	if (start == NULL)
+		return;
+
+	pthread_mutex_lock(&registry_lock);
+	struct OwnerRecord *record = find_record(allocator, start);
+	if (record != NULL)
+	{
+		for (uintptr_t page = PAGE_OF(record->start); page <= PAGE_OF(record->end - 1); page++)
+			page_remove(page, record);
+		record->next_free	= free_records;
+		free_records		= record;
+	}
+	pthread_mutex_unlock(&registry_lock);
+}
+
+void *owner_lookup(const void *ptr, AllocatorKind *kind)
+{
+	PageEntry *entry = page_entry(PAGE_OF(ptr), 0);
+	if (entry == NULL)
+		return NULL;
+
+	void *allocator = find_owner(entry, ptr, kind, MAX_SHARE_STEPS);
+	if (LIKELY(allocator != NULL))
+		return allocator;
+
+	// miss is either foreign pointer or a race with recycling, the locked walk is exact
+	pthread_mutex_lock(&registry_lock);
+	allocator = find_owner(entry, ptr, kind, SIZE_MAX);
+	pthread_mutex_unlock(&registry_lock);
+	return allocator;
+}
+
+void alloc_free(void *ptr)
+{
+#ifdef IGNORE_NULL
+	if (ptr == NULL)
+		return;
+#else
+	ASSERT(ptr != NULL);
+#endif
+	AllocatorKind kind;
+	void *allocator = owner_lookup(ptr, &kind);
+	if (allocator == NULL)
+	{
+		M_ASSERT(allocator != NULL, "Pointer doesn't belong to any allocator");
+		return;
+	}
+
+	switch (kind)
+	{
+		case ALLOCATOR_STACK:
+			sa_free((StackAllocator *)allocator, ptr);
+			break;
+		case ALLOCATOR_POOL:
+			pa_free((PoolAllocator *)allocator, ptr);
+			break;
+		case ALLOCATOR_DOUBLE_ENDED:
+		{
+			DoubleEndedStackAllocator *double_ended = (DoubleEndedStackAllocator *)allocator;
+			if ((char *)ptr < double_ended->current_front)
+				desa_front_free(double_ended, ptr);
+			else
+				desa_back_free(double_ended, ptr);
+			break;
+		}
+		case ALLOCATOR_SHARED_POOL:
+			spa_free((SharedPoolAllocator *)allocator, ptr);
+			break;
+		case ALLOCATOR_GROWABLE_POOL:
+			gpa_free((GrowablePoolAllocator *)allocator, ptr);
+			break;
+		default:
+			// linear arenas and spill of double-buffered allocator free everything at once
+			break;
+	}
+}
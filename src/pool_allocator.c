@@ -1,9 +1,14 @@
 #include "../include/pool_allocator.h"
 #include "../debug/debug.h"			// M_ASSERT, PRINT, show_memory
-#include "../include/memory.h"			// DEFAULT_ALIGNMENT
+#include "../include/memory.h"			// DEFAULT_ALIGNMENT, UNLIKELY, NOINLINE
+#include "../include/allocation_trace.h"	// TRACE_ALLOC, TRACE_FREE, TRACE_RESET
+#include "../include/owner_registry.h"		// owner_register, owner_unregister
+#include "../include/virtual_memory.h"		// vm_prefault
+#include "../include/memory_provider.h"		// mp_acquire, mp_release
 #include <stdlib.h>				// malloc, free
 
-void pa_init_aligned(PoolAllocator *allocator, const size_t num_of_elements, const size_t element_size, const size_t alignment)
+// elements are placed in memory of 'provider', malloc'ed if it's NULL
+static void pa_init_elements(PoolAllocator *allocator, MemoryProvider *provider, const size_t num_of_elements, const size_t element_size, const size_t alignment)
 {
 	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
 	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
@@ -20,17 +25,35 @@ void pa_init_aligned(PoolAllocator *allocator, const size_t num_of_elements, con
 	allocator->num_of_elements	= num_of_elements;
 	allocator->element_size		= aligned_element_size;
 
-	// allocate memory
-	char *ptr = (char *)malloc(aligned_size);
-	
-	MEMSET_ZERO(ptr, aligned_size);
+	// allocate memory, malloc alignment is enough only up to two pointers
+	char *ptr = NULL;
+	if (provider != NULL)
+		ptr = (char *)mp_acquire(provider, aligned_size, alignment);
+	else if (alignment <= 2 * sizeof(void *))
+		ptr = (char *)malloc(aligned_size);
+	else if (posix_memalign((void **)&ptr, alignment, aligned_size) != 0)
+		ptr = NULL;
 
 	// save pointer to head of allocated block
-	allocator->start = ptr;
+	allocator->start	= ptr;
+	allocator->owner	= NULL;
+	allocator->provider	= provider;
+	allocator->remote	= NULL;
 
 	// starting in head
 	allocator->freelist.next = (struct FreeList *)ptr;
 
+	// pool without memory stays empty, every allocation fails
+	if (ptr == NULL)
+	{
+		allocator->num_of_elements	= 0;
+		allocator->element_size		= 0;
+		return;
+	}
+
+	MEMSET_ZERO(ptr, aligned_size);
+	owner_register(allocator, ALLOCATOR_POOL, ptr, ptr + aligned_size);
+
 	// create iterator that starts in head too
 	struct FreeList *iterator = allocator->freelist.next;
 
@@ -47,6 +70,17 @@ void pa_init_aligned(PoolAllocator *allocator, const size_t num_of_elements, con
 	iterator->next = NULL;
 }
 
+void pa_init_aligned(PoolAllocator *allocator, const size_t num_of_elements, const size_t element_size, const size_t alignment)
+{
+	pa_init_elements(allocator, NULL, num_of_elements, element_size, alignment);
+}
+
+void pa_init_from(PoolAllocator *allocator, MemoryProvider *provider, const size_t num_of_elements, const size_t element_size, const size_t alignment)
+{
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	pa_init_elements(allocator, provider, num_of_elements, element_size, alignment);
+}
+
 void pa_init(PoolAllocator *allocator, const size_t num_of_elements, const size_t element_size)
 {
 	pa_init_aligned(allocator, num_of_elements, element_size, DEFAULT_ALIGNMENT);
@@ -55,14 +89,47 @@ void pa_init(PoolAllocator *allocator, const size_t num_of_elements, const size_
 void pa_terminate(PoolAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
-	free(allocator->start);
-	allocator->start = NULL;
+	TRACE_RESET(ALLOCATOR_POOL, allocator);
+	owner_unregister(allocator, allocator->start);
+	if (allocator->provider != NULL)
+		mp_release(allocator->provider, allocator->start, allocator->num_of_elements * allocator->element_size);
+	else
+		free(allocator->start);
+	allocator->provider	= NULL;
+	allocator->start	= NULL;
+}
+
+// address of a thread-local is unique among running threads
+static _Thread_local char thread_tag;
+
+void pa_set_owner(PoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
+	allocator->owner = &thread_tag;
+}
+
+// owner's free list is empty, elements freed by other threads become the free list
+static NOINLINE int pa_reclaim_remote(PoolAllocator *allocator)
+{
+	if (allocator->owner == NULL)
+		return 0;
+	allocator->freelist.next = __atomic_exchange_n(&allocator->remote, NULL, __ATOMIC_ACQUIRE);
+	return allocator->freelist.next != NULL;
+}
+
+// MPSC push, the owner takes the whole list, so popped elements can't come back under a pusher (no ABA)
+static NOINLINE void pa_remote_free(PoolAllocator *allocator, struct FreeList *element)
+{
+	element->next = __atomic_load_n(&allocator->remote, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&allocator->remote, &element->next, element, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
 }
 
 void *pa_alloc(PoolAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
-	if (allocator->freelist.next == NULL)
+	M_ASSERT(allocator->owner == NULL || allocator->owner == &thread_tag, "Pool is allocated from outside of its owner thread");
+	if (UNLIKELY(allocator->freelist.next == NULL) && !pa_reclaim_remote(allocator))
 	{
 		PRINT("There is no available space");
 		return NULL;
@@ -73,6 +140,7 @@ void *pa_alloc(PoolAllocator *allocator)
 
 	// make next element address a new entry point
 	allocator->freelist.next = head->next;
+	TRACE_ALLOC(ALLOCATOR_POOL, allocator, head, allocator->element_size, 0);
 
 	// return first element
 	return head;
@@ -88,6 +156,12 @@ void pa_free(PoolAllocator *allocator, void *ptr)
 	ASSERT(ptr != NULL);
 #endif
 	struct FreeList *head = (struct FreeList *)ptr;
+	TRACE_FREE(ALLOCATOR_POOL, allocator, ptr);
+	if (UNLIKELY(allocator->owner != NULL && allocator->owner != &thread_tag))
+	{
+		pa_remote_free(allocator, head);
+		return;
+	}
 
 	// make returned chunk point to head of free list
 	head->next = allocator->freelist.next;
@@ -99,7 +173,12 @@ void pa_free(PoolAllocator *allocator, void *ptr)
 void pa_reset(PoolAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
+	TRACE_RESET(ALLOCATOR_POOL, allocator);
+	if (allocator->start == NULL)
+		return;
+
 	MEMSET_ZERO(allocator->start, allocator->num_of_elements * allocator->element_size);
+	__atomic_store_n(&allocator->remote, NULL, __ATOMIC_RELAXED);
 
 	struct FreeList *iterator = (struct FreeList *)allocator->start;
 	char *ptr = allocator->start;
@@ -114,6 +193,12 @@ void pa_reset(PoolAllocator *allocator)
 	allocator->freelist.next = (struct FreeList *)allocator->start;
 }
 
+void pa_prefault(PoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
+	vm_prefault(allocator->start, allocator->num_of_elements * allocator->element_size);
+}
+
 void pa_show_memory(PoolAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Pool Allocator is NULL");
@@ -0,0 +1,60 @@
+#include "../include/scratch.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/memory.h"				// UNLIKELY
+#include <pthread.h>					// pthread_once, pthread_key_create, pthread_setspecific
+
+static __thread StackAllocator arenas[SCRATCH_ARENA_COUNT];
+static __thread int arenas_ready;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t key;
+
+// releases arenas of exiting thread
+static void scratch_terminate(void *thread_arenas)
+{
+	StackAllocator *allocators = (StackAllocator *)thread_arenas;
+	for (int i = 0; i < SCRATCH_ARENA_COUNT; i++)
+		sa_terminate(&allocators[i]);
+}
+
+static void scratch_create_key(void)
+{
+	pthread_key_create(&key, scratch_terminate);
+}
+
+// address space is reserved on first use in a thread
+static void scratch_init_thread(void)
+{
+	for (int i = 0; i < SCRATCH_ARENA_COUNT; i++)
+		sa_init_virtual(&arenas[i], SCRATCH_ARENA_SIZE, 0);
+
+	pthread_once(&key_once, scratch_create_key);
+	pthread_setspecific(key, arenas);
+	arenas_ready = 1;
+}
+
+Scratch scratch_begin(StackAllocator *const *conflicts, const size_t num_of_conflicts)
+{
+	if (UNLIKELY(!arenas_ready))
+		scratch_init_thread();
+
+	for (int i = 0; i < SCRATCH_ARENA_COUNT; i++)
+	{
+		size_t j = 0;
+		while (j < num_of_conflicts && conflicts[j] != &arenas[i])
+			j++;
+
+		if (j == num_of_conflicts)
+			return (Scratch){ &arenas[i], sa_get_marker(&arenas[i]) };
+	}
+
+	PRINT("Every scratch arena conflicts");
+	return (Scratch){ NULL, 0 };
+}
+
+void scratch_end(Scratch *scratch)
+{
+	M_ASSERT(scratch != NULL, "Scratch is NULL");
+	if (scratch->arena != NULL)
+		sa_free_to_marker(scratch->arena, scratch->marker);
+}
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE					// memfd_create
+#include "../include/shared_pool_allocator.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT, show_memory
+#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_FREE
+#include "../include/owner_registry.h"			// owner_register, owner_unregister
+#include <stdatomic.h>					// atomic_load_explicit, atomic_compare_exchange_weak_explicit
+#include <stdint.h>					// uint32_t, uint64_t
+#include <fcntl.h>					// O_CREAT, O_EXCL, O_RDWR
+#include <unistd.h>					// ftruncate, close
+#include <sys/mman.h>					// mmap, munmap, shm_open, shm_unlink, memfd_create
+#include <sys/stat.h>					// fstat
+
+#define SHARED_POOL_MAGIC		0x4C4F4F5044524853ULL
+#define CACHE_LINE_SIZE			64
+
+// free list head: ABA tag in the upper half, index of first free element + 1 in the lower half (0 - empty)
+#define HEAD_INDEX(head)		((uint32_t)(head))
+#define HEAD_TAG(head)			((uint32_t)((head) >> 32))
+#define MAKE_HEAD(tag, index)	(((uint64_t)(tag) << 32) | (uint64_t)(index))
+
+// first word of a free element keeps index of the next free element + 1
+#define ELEMENT(allocator, index)	((allocator)->start + (size_t)(index) * (allocator)->header->element_size)
+#define ELEMENT_LINK(element)		((_Atomic uint32_t *)(element))
+
+struct SharedPoolHeader
+{
+	_Atomic uint64_t magic;				// stored last, pool is ready when it is set
+	uint64_t num_of_elements;
+	uint64_t element_size;
+	uint64_t elements_offset;
+	_Alignas(CACHE_LINE_SIZE) _Atomic uint64_t freelist;
+};
+
+static int spa_map(SharedPoolAllocator *allocator, const int fd, const size_t size)
+{
+	void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+	{
+		PRINT("Unable to map shared memory");
+		return 0;
+	}
+	allocator->header		= (struct SharedPoolHeader *)ptr;
+	allocator->mapped_size	= size;
+	allocator->fd			= fd;
+	return 1;
+}
+
+int spa_create(SharedPoolAllocator *allocator, const char *name, const size_t num_of_elements, const size_t element_size)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	M_ASSERT(num_of_elements < UINT32_MAX, "Too many elements");
+
+	const int fd = (name == NULL) ? memfd_create("shared_pool", 0) : shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		PRINT("Unable to create shared memory");
+		return 0;
+	}
+
+	// element has to fit a link, header doesn't share a cache line with elements
+	const size_t aligned_element_size	= ALIGNED_SIZE(element_size < sizeof(uint32_t) ? sizeof(uint32_t) : element_size, DEFAULT_ALIGNMENT);
+	const size_t elements_offset		= ALIGNED_SIZE(sizeof(struct SharedPoolHeader), CACHE_LINE_SIZE);
+	const size_t total_size				= elements_offset + num_of_elements * aligned_element_size;
+
+	// new shared memory is filled with zeros
+	if (ftruncate(fd, (off_t)total_size) != 0 || !spa_map(allocator, fd, total_size))
+	{
+		PRINT("Unable to size shared memory");
+		close(fd);
+		if (name != NULL)
+			shm_unlink(name);
+		return 0;
+	}
+
+	struct SharedPoolHeader *header = allocator->header;
+	header->num_of_elements	= num_of_elements;
+	header->element_size	= aligned_element_size;
+	header->elements_offset	= elements_offset;
+	allocator->start		= (char *)header + elements_offset;
+
+	// every element points to the next one, last element doesn't point to anything
+	for (size_t i = 0; i < num_of_elements; i++)
+		atomic_store_explicit(ELEMENT_LINK(ELEMENT(allocator, i)), (i + 1 < num_of_elements) ? (uint32_t)(i + 2) : 0, memory_order_relaxed);
+
+	atomic_store_explicit(&header->freelist, MAKE_HEAD(0, num_of_elements != 0), memory_order_relaxed);
+
+	// publish initialized pool to attaching processes
+	atomic_store_explicit(&header->magic, SHARED_POOL_MAGIC, memory_order_release);
+	owner_register(allocator, ALLOCATOR_SHARED_POOL, allocator->start, (char *)header + allocator->mapped_size);
+	return 1;
+}
+
+int spa_attach_fd(SharedPoolAllocator *allocator, const int fd)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+
+	struct stat file_info;
+	if (fstat(fd, &file_info) != 0 || (size_t)file_info.st_size < sizeof(struct SharedPoolHeader))
+	{
+		PRINT("Shared memory is not a pool");
+		return 0;
+	}
+
+	if (!spa_map(allocator, fd, (size_t)file_info.st_size))
+		return 0;
+
+	struct SharedPoolHeader *header = allocator->header;
+	if (atomic_load_explicit(&header->magic, memory_order_acquire) != SHARED_POOL_MAGIC ||
+		header->elements_offset + header->num_of_elements * header->element_size > allocator->mapped_size)
+	{
+		PRINT("Shared pool is not initialized");
+		munmap(header, allocator->mapped_size);
+		allocator->header = NULL;
+		return 0;
+	}
+
+	allocator->start = (char *)header + header->elements_offset;
+	owner_register(allocator, ALLOCATOR_SHARED_POOL, allocator->start, (char *)header + allocator->mapped_size);
+	return 1;
+}
+
+int spa_attach(SharedPoolAllocator *allocator, const char *name)
+{
+	M_ASSERT(name != NULL, "Name is NULL");
+	const int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0)
+	{
+		PRINT("Unable to open shared memory");
+		return 0;
+	}
+
+	if (!spa_attach_fd(allocator, fd))
+	{
+		close(fd);
+		return 0;
+	}
+	return 1;
+}
+
+void spa_detach(SharedPoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	owner_unregister(allocator, allocator->start);
+	munmap(allocator->header, allocator->mapped_size);
+	close(allocator->fd);
+	allocator->header	= NULL;
+	allocator->start	= NULL;
+	allocator->fd		= -1;
+}
+
+void spa_unlink(const char *name)
+{
+	M_ASSERT(name != NULL, "Name is NULL");
+	shm_unlink(name);
+}
+
+void *spa_alloc(SharedPoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	struct SharedPoolHeader *header = allocator->header;
+
+	uint64_t head = atomic_load_explicit(&header->freelist, memory_order_acquire);
+	uint64_t new_head;
+	do
+	{
+		if (HEAD_INDEX(head) == 0)
+		{
+			PRINT("There is no available space");
+			return NULL;
+		}
+
+		// element may be taken by someone else meanwhile, then tag won't match and we retry
+		const uint32_t next = atomic_load_explicit(ELEMENT_LINK(ELEMENT(allocator, HEAD_INDEX(head) - 1)), memory_order_relaxed);
+		new_head = MAKE_HEAD(HEAD_TAG(head) + 1, next);
+	} while (!atomic_compare_exchange_weak_explicit(&header->freelist, &head, new_head, memory_order_acquire, memory_order_acquire));
+
+	void *ptr = ELEMENT(allocator, HEAD_INDEX(head) - 1);
+	TRACE_ALLOC(ALLOCATOR_SHARED_POOL, allocator, ptr, header->element_size, 0);
+	return ptr;
+}
+
+void spa_free(SharedPoolAllocator *allocator, void *ptr)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+#ifdef IGNORE_NULL
+	if (ptr == NULL)
+		return;
+#else
+	ASSERT(ptr != NULL);
+#endif
+	struct SharedPoolHeader *header = allocator->header;
+	const size_t offset = (size_t)((char *)ptr - allocator->start);
+
+	M_ASSERT((char *)ptr >= allocator->start && offset < header->num_of_elements * header->element_size, "Pointer is out of the pool borders");
+	M_ASSERT(offset % header->element_size == 0, "Pointer is not at the element beginning");
+
+	const uint32_t index = (uint32_t)(offset / header->element_size);
+
+	uint64_t head = atomic_load_explicit(&header->freelist, memory_order_relaxed);
+	do
+	{
+		// make returned element point to head of free list
+		atomic_store_explicit(ELEMENT_LINK(ptr), HEAD_INDEX(head), memory_order_relaxed);
+	} while (!atomic_compare_exchange_weak_explicit(&header->freelist, &head, MAKE_HEAD(HEAD_TAG(head) + 1, index + 1),
+		memory_order_release, memory_order_relaxed));
+	TRACE_FREE(ALLOCATOR_SHARED_POOL, allocator, ptr);
+}
+
+size_t spa_to_offset(SharedPoolAllocator *allocator, const void *ptr)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	M_ASSERT((const char *)ptr >= allocator->start && (const char *)ptr < (char *)allocator->header + allocator->mapped_size, "Pointer is out of the pool borders");
+	return (size_t)((const char *)ptr - (char *)allocator->header);
+}
+
+void *spa_from_offset(SharedPoolAllocator *allocator, const size_t offset)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	M_ASSERT(offset < allocator->mapped_size, "Offset is out of the pool borders");
+	return (char *)allocator->header + offset;
+}
+
+const size_t spa_element_size(SharedPoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	return (const size_t)allocator->header->element_size;
+}
+
+const size_t spa_num_of_elements(SharedPoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	return (const size_t)allocator->header->num_of_elements;
+}
+
+void spa_show_memory(SharedPoolAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Shared Pool Allocator is NULL");
+	PRINT("Memory occupied by SharedPoolAllocator:");
+	show_memory(allocator->start, spa_element_size(allocator) * spa_num_of_elements(allocator));
+}
+
+void spa_show_all_info(SharedPoolAllocator *allocator)
+{
+	PRINT_UINT(spa_element_size(allocator));
+	PRINT_UINT(spa_num_of_elements(allocator));
+	spa_show_memory(allocator);
+}
@@ -0,0 +1,145 @@
+#include "../include/soa_pool.h"
+#include "../debug/debug.h"			// M_ASSERT, PRINT
+#include "../include/memory.h"			// ALIGNED_SIZE, UNLIKELY
+#include <stdlib.h>				// posix_memalign, free
+#include <string.h>				// memcpy, memset
+
+// every array starts on its own cache line, so vector loads never split across arrays
+#define CACHE_LINE_SIZE		64
+
+// free handles are chained in ascending order, so handles are given out as 0, 1, 2...
+static void link_handles(SoaPool *pool)
+{
+	for (size_t i = 0; i < pool->capacity; i++)
+		pool->handle_to_index[i] = i + 1 < pool->capacity ? i + 1 : SOA_NO_HANDLE;
+	pool->free_handle = pool->capacity > 0 ? 0 : SOA_NO_HANDLE;
+	pool->count = 0;
+}
+
+void soa_init(SoaPool *pool, const size_t capacity, const SoaField *fields, const size_t num_of_fields)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	M_ASSERT(num_of_fields > 0 && num_of_fields <= SOA_MAX_FIELDS, "Incorrect number of fields");
+
+	// offsets of the arrays in one block, stride of a field is the distance between elements in C array
+	size_t offsets[SOA_MAX_FIELDS];
+	size_t size = 0;
+	for (size_t i = 0; i < num_of_fields; i++)
+	{
+		const size_t alignment = fields[i].alignment;
+		M_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Incorrect alignment");
+		M_ASSERT(alignment <= CACHE_LINE_SIZE, "Field alignment is bigger than cache line");
+
+		pool->strides[i]	= ALIGNED_SIZE(fields[i].size, alignment);
+		offsets[i]		= size;
+		size			= ALIGNED_SIZE(size + capacity * pool->strides[i], CACHE_LINE_SIZE);
+	}
+	const size_t indices_offset = size;
+	size += 2 * capacity * sizeof(size_t);
+
+	char *ptr = NULL;
+	if (posix_memalign((void **)&ptr, CACHE_LINE_SIZE, size) != 0)
+	{
+		PRINT("Can't allocate memory for SoA Pool");
+		ptr = NULL;
+	}
+
+	pool->start		= ptr;
+	pool->num_of_fields	= num_of_fields;
+	pool->capacity		= ptr != NULL ? capacity : 0;
+	for (size_t i = 0; i < num_of_fields; i++)
+		pool->arrays[i] = ptr + offsets[i];
+	pool->handle_to_index	= (size_t *)(ptr + indices_offset);
+	pool->index_to_handle	= pool->handle_to_index + capacity;
+	link_handles(pool);
+}
+
+size_t soa_alloc(SoaPool *pool)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	if (UNLIKELY(pool->free_handle == SOA_NO_HANDLE))
+	{
+		PRINT("There is no available space");
+		return SOA_NO_HANDLE;
+	}
+
+	const size_t handle	= pool->free_handle;
+	const size_t index	= pool->count++;
+	pool->free_handle	= pool->handle_to_index[handle];
+	pool->handle_to_index[handle]	= index;
+	pool->index_to_handle[index]	= handle;
+
+	// hole left by swap-remove holds old values
+	for (size_t i = 0; i < pool->num_of_fields; i++)
+		memset(pool->arrays[i] + index * pool->strides[i], 0, pool->strides[i]);
+	return handle;
+}
+
+void soa_free(SoaPool *pool, const size_t handle)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+#ifdef IGNORE_NULL
+	if (handle == SOA_NO_HANDLE)
+		return;
+#else
+	ASSERT(handle != SOA_NO_HANDLE);
+#endif
+	M_ASSERT(handle < pool->capacity, "Handle doesn't belong to the pool");
+	const size_t index = pool->handle_to_index[handle];
+	M_ASSERT(index < pool->count && pool->index_to_handle[index] == handle, "Element is already free");
+
+	// last element fills the hole, arrays stay dense
+	const size_t last = --pool->count;
+	if (index != last)
+	{
+		for (size_t i = 0; i < pool->num_of_fields; i++)
+			memcpy(pool->arrays[i] + index * pool->strides[i], pool->arrays[i] + last * pool->strides[i], pool->strides[i]);
+
+		const size_t moved = pool->index_to_handle[last];
+		pool->index_to_handle[index]	= moved;
+		pool->handle_to_index[moved]	= index;
+	}
+
+	pool->handle_to_index[handle]	= pool->free_handle;
+	pool->free_handle		= handle;
+}
+
+void *soa_get(SoaPool *pool, const size_t handle, const size_t field)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	M_ASSERT(field < pool->num_of_fields, "Incorrect field");
+	return pool->arrays[field] + pool->handle_to_index[handle] * pool->strides[field];
+}
+
+void soa_reset(SoaPool *pool)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	link_handles(pool);
+}
+
+void soa_terminate(SoaPool *pool)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	free(pool->start);
+	pool->start	= NULL;
+	pool->capacity	= 0;
+	pool->count	= 0;
+}
+
+const size_t soa_count(SoaPool *pool)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	return pool->count;
+}
+
+void soa_show_all_info(SoaPool *pool)
+{
+	M_ASSERT(pool != NULL, "SoA Pool is NULL");
+	PRINT_UINT(pool->capacity);
+	PRINT_UINT(soa_count(pool));
+	for (size_t i = 0; i < pool->num_of_fields; i++)
+	{
+		PRINT_HEX(pool->arrays[i]);
+		PRINT_UINT(pool->strides[i]);
+	}
+}
@@ -1,24 +1,94 @@
 #include "../include/stack_allocator.h"
 #include "../debug/debug.h"				// M_ASSERT, ASSERT, PRINT, show_memory
-#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
+#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT, UNLIKELY, NOINLINE
+#include "../include/virtual_memory.h"		// vm_reserve, vm_release, vm_grow_committed, vm_prefault
+#include "../include/allocation_trace.h"		// TRACE_ALLOC, TRACE_FREE, TRACE_RESET, TRACE_RESET_RANGE
+#include "../include/owner_registry.h"			// owner_register, owner_extend, owner_unregister
+#include "../include/memory_provider.h"		// mp_release, mp_grow_committed
 #include <stdlib.h>					// malloc, free
 
 #define SIZE_OF_ALLOCATION_BLOCK_SIZE sizeof(size_t)  
 
+// block sizes are multiples of DEFAULT_ALIGNMENT, this bit of the size tells that the block
+// starts with alignment padding, whose size is stored right before the block size
+#define PADDED_BLOCK		((size_t)2)
+
 void sa_init(StackAllocator *allocator, const size_t total_size)
 {
 	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
 	allocator->start	= (char *)malloc(total_size);
 	allocator->end		= allocator->start + total_size;
 	allocator->current	= allocator->start;
+	allocator->committed	= allocator->end;
+	allocator->commit_chunk	= 0;
+	allocator->backing	= MEMORY_HEAP;
+	allocator->provider	= NULL;
+	owner_register(allocator, ALLOCATOR_STACK, allocator->start, allocator->end);
 	MEMSET_ZERO(allocator->start, total_size);
 }
 
+void sa_init_virtual(StackAllocator *allocator, const size_t total_size, const size_t commit_chunk)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	allocator->start	= (char *)vm_reserve(total_size);
+	// failed reservation leaves the arena empty, every allocation fails
+	allocator->end		= allocator->start ? allocator->start + total_size : NULL;
+	allocator->current	= allocator->start;
+	allocator->committed	= allocator->start;
+	allocator->commit_chunk	= ALIGNED_SIZE(commit_chunk ? commit_chunk : DEFAULT_COMMIT_CHUNK, vm_page_size());
+	allocator->backing	= MEMORY_VIRTUAL;
+	allocator->provider	= NULL;
+}
+
+void sa_init_from(StackAllocator *allocator, MemoryProvider *provider, const size_t total_size)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	M_ASSERT(provider != NULL, "Memory Provider is NULL");
+	allocator->start	= (char *)provider->reserve(provider, total_size, DEFAULT_ALIGNMENT);
+	// full buffer or parent leaves the arena empty, every allocation fails
+	allocator->end		= allocator->start ? allocator->start + total_size : NULL;
+	allocator->current	= allocator->start;
+	allocator->committed	= provider->commit ? allocator->start : allocator->end;
+	allocator->commit_chunk	= provider->commit ? ALIGNED_SIZE(DEFAULT_COMMIT_CHUNK, vm_page_size()) : 0;
+	allocator->backing	= MEMORY_PROVIDED;
+	allocator->provider	= provider;
+	if (allocator->start != NULL && provider->commit == NULL)
+	{
+		owner_register(allocator, ALLOCATOR_STACK, allocator->start, allocator->end);
+		MEMSET_ZERO(allocator->start, total_size);
+	}
+}
+
 void sa_terminate(StackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
-	free(allocator->start);
-	allocator->current = allocator->start = allocator->end = NULL;
+	TRACE_RESET(ALLOCATOR_STACK, allocator);
+	owner_unregister(allocator, allocator->start);
+	if (allocator->backing == MEMORY_VIRTUAL)
+		vm_release(allocator->start, (size_t)(allocator->end - allocator->start));
+	else if (allocator->backing == MEMORY_PROVIDED)
+		mp_release(allocator->provider, allocator->start, (size_t)(allocator->end - allocator->start));
+	else
+		free(allocator->start);
+	allocator->provider = NULL;
+	allocator->current = allocator->start = allocator->end = allocator->committed = NULL;
+}
+
+// moves commit watermark so 'size' bytes fit after current pointer
+static NOINLINE int sa_commit(StackAllocator *allocator, const size_t size)
+{
+	if (allocator->commit_chunk == 0 || size > (size_t)(allocator->end - allocator->current))
+		return 0;
+
+	char *committed = (allocator->backing == MEMORY_VIRTUAL)
+		? vm_grow_committed(allocator->committed, allocator->current + size, allocator->end, allocator->commit_chunk)
+		: mp_grow_committed(allocator->provider, allocator->committed, allocator->current + size, allocator->end, allocator->commit_chunk);
+	if (committed == NULL)
+		return 0;
+
+	allocator->committed = committed;
+	owner_extend(allocator, ALLOCATOR_STACK, allocator->start, committed);
+	return 1;
 }
 
 void *sa_alloc_aligned(StackAllocator *allocator, const size_t size, const size_t alignment)
@@ -26,22 +96,30 @@ void *sa_alloc_aligned(StackAllocator *allocator, const size_t size, const size_
 	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
 	M_ASSERT((alignment & (alignment - 1)) == 0, "Incorrect alignment");
 	
-	const size_t aligned_size = ALIGNED_SIZE(SIZE_OF_ALLOCATION_BLOCK_SIZE + size, alignment);
+	// block: padding, allocation block size, allocation aligned to 'alignment', padding up to DEFAULT_ALIGNMENT
+	// current pointer always stays aligned to DEFAULT_ALIGNMENT, so is allocation block size
+	char *ptr = ALIGN_POINTER(allocator->current + SIZE_OF_ALLOCATION_BLOCK_SIZE, alignment < DEFAULT_ALIGNMENT ? DEFAULT_ALIGNMENT : alignment);
+	const size_t aligned_size = (size_t)(ALIGN_POINTER(ptr + size, DEFAULT_ALIGNMENT) - allocator->current);
 
-	if (allocator->current + aligned_size > allocator->end)
+	// heap memory is committed entirely, so only virtual arenas leave the fast path successfully
+	if (UNLIKELY(aligned_size > (size_t)(allocator->committed - allocator->current)) && !sa_commit(allocator, aligned_size))
 	{
 		PRINT("There is no available space");
 		return NULL;
 	}
 	
-	char *ptr = (char *)allocator->current;
-
-	// cast to size_t for storing allocation block size in first 4 bytes
-	*((size_t *)(ptr)) = aligned_size;
-	ptr += SIZE_OF_ALLOCATION_BLOCK_SIZE;
+	// cast to size_t for storing allocation block size right before allocation
+	size_t *header = (size_t *)(ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE);
+	*header = aligned_size;
+	if (UNLIKELY((char *)header != allocator->current))
+	{
+		header[-1] = (size_t)((char *)header - allocator->current);
+		*header |= PADDED_BLOCK;
+	}
 
 	// update current pointer
 	allocator->current += aligned_size;
+	TRACE_ALLOC(ALLOCATOR_STACK, allocator, ptr, size, alignment);
 	return (void *)ptr;
 }
 
@@ -61,23 +139,69 @@ void sa_free(StackAllocator *allocator, void *ptr)
 #endif
 	ASSERT(((char *)ptr > allocator->start) && ((char *)ptr < allocator->current));
 
-	char *temp_ptr = (char *)ptr;
+	// get size of allocated block and its start, padding is in front of the header
+	size_t *header = (size_t *)((char *)ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE);
+	const size_t allocation_size = *header & ~PADDED_BLOCK;
+	char *block_start = (char *)header - ((*header & PADDED_BLOCK) ? header[-1] : 0);
 
-	// get size of allocated block
-	temp_ptr -= SIZE_OF_ALLOCATION_BLOCK_SIZE;
-	const size_t allocation_size = *((size_t*)temp_ptr);
-
-	M_ASSERT(allocation_size == (size_t)(allocator->current - temp_ptr), "Attempt to free non-top block of stack");
+	M_ASSERT(block_start + allocation_size == allocator->current, "Attempt to free non-top block of stack");
 
 	// update current pointer
-	allocator->current -= allocation_size;
+	allocator->current = block_start;
+	TRACE_FREE(ALLOCATOR_STACK, allocator, ptr);
+}
+
+int sa_resize(StackAllocator *allocator, void *ptr, const size_t old_size, const size_t new_size)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	char *old_end = ALIGN_POINTER((char *)ptr + old_size, DEFAULT_ALIGNMENT);
+	if (old_end != allocator->current)
+		return 0;
+
+	char *new_end = ALIGN_POINTER((char *)ptr + new_size, DEFAULT_ALIGNMENT);
+	if (UNLIKELY(new_end > allocator->committed) && !sa_commit(allocator, (size_t)(new_end - allocator->current)))
+		return 0;
+
+	// block size in header changes together with the block end
+	*((size_t *)((char *)ptr - SIZE_OF_ALLOCATION_BLOCK_SIZE)) += (size_t)(new_end - old_end);
+	allocator->current = new_end;
+	TRACE_FREE(ALLOCATOR_STACK, allocator, ptr);
+	TRACE_ALLOC(ALLOCATOR_STACK, allocator, ptr, new_size, 0);
+	return 1;
+}
+
+int sa_prefault(StackAllocator *allocator, const size_t size)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	const size_t remaining = (size_t)(allocator->end - allocator->current);
+	const size_t prefault_size = (size == 0 || size > remaining) ? remaining : size;
+	if (prefault_size > (size_t)(allocator->committed - allocator->current) && !sa_commit(allocator, prefault_size))
+		return 0;
+
+	vm_prefault(allocator->current, prefault_size);
+	return 1;
 }
 
 void sa_reset(StackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	TRACE_RESET(ALLOCATOR_STACK, allocator);
 	allocator->current = allocator->start;
-	MEMSET_ZERO(allocator->start, (const size_t)(allocator->end - allocator->start));
+	MEMSET_ZERO(allocator->start, (const size_t)(allocator->committed - allocator->start));
+}
+
+const size_t sa_get_marker(StackAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	return (const size_t)(allocator->current - allocator->start);
+}
+
+void sa_free_to_marker(StackAllocator *allocator, const size_t marker)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	M_ASSERT(allocator->start + marker <= allocator->current, "Marker is above the top of stack");
+	TRACE_RESET_RANGE(ALLOCATOR_STACK, allocator, allocator->start + marker, (size_t)(allocator->current - allocator->start - marker));
+	allocator->current = allocator->start + marker;
 }
 
 const size_t sa_used_space(StackAllocator *allocator)
@@ -92,11 +216,17 @@ const size_t sa_remaining_space(StackAllocator *allocator)
 	return (const size_t)(allocator->end - allocator->current);
 }
 
+const size_t sa_committed_space(StackAllocator *allocator)
+{
+	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
+	return (const size_t)(allocator->committed - allocator->start);
+}
+
 void sa_show_memory(StackAllocator *allocator)
 {
 	M_ASSERT(allocator != NULL, "Stack Allocator is NULL");
 	PRINT("Memory occupied by StackAllocator:");
-	show_memory(allocator->start, (const size_t)(allocator->end - allocator->start));
+	show_memory(allocator->start, (const size_t)(allocator->committed - allocator->start));
 }
 
 void sa_space_info(StackAllocator *allocator)
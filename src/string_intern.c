@@ -0,0 +1,149 @@
+#include "../include/string_intern.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/memory.h"				// UNLIKELY, NOINLINE
+#include <string.h>					// memcpy, memcmp, memset, strlen
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>				// _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+#define MIN_INTERN_CAPACITY		16
+#define HASH_MULTIPLIER			0x9E3779B97F4A7C15ULL
+
+// 8 bytes per step: xor, multiply, fold high half down
+uint32_t intern_hash(const char *text, const size_t length)
+{
+	uint64_t hash = length * HASH_MULTIPLIER;
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8)
+	{
+		uint64_t chunk;
+		memcpy(&chunk, text + i, 8);
+		hash = (hash ^ chunk) * HASH_MULTIPLIER;
+		hash ^= hash >> 32;
+	}
+
+	uint64_t tail = 0;
+	memcpy(&tail, text + i, length - i);
+	hash = (hash ^ tail) * HASH_MULTIPLIER;
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// hashes and lengths are equal already, so mismatches are rare
+static int equal(const char *a, const char *b, const size_t length)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 16 <= length; i += 16)
+	{
+		const __m128i chunk_a = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i chunk_b = _mm_loadu_si128((const __m128i *)(b + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_a, chunk_b)) != 0xFFFF)
+			return 0;
+	}
+#endif
+	return memcmp(a + i, b + i, length - i) == 0;
+}
+
+// returns slot of 'text' or empty slot where it belongs
+static struct InternSlot *find_slot(InternTable *table, const char *text, const size_t length, const uint32_t hash)
+{
+	size_t index = hash & (table->capacity - 1);
+	for (;;)
+	{
+		struct InternSlot *slot = &table->slots[index];
+		if (slot->string == NULL || (slot->hash == hash && slot->length == length && equal(slot->string, text, length)))
+			return slot;
+		index = (index + 1) & (table->capacity - 1);
+	}
+}
+
+static NOINLINE int intern_grow(InternTable *table, const size_t capacity)
+{
+	struct InternSlot *slots = la_alloc_aligned(table->arena, capacity * sizeof(struct InternSlot), 64);
+	if (slots == NULL)
+		return 0;
+	memset(slots, 0, capacity * sizeof(struct InternSlot));
+
+	// hashes are kept, strings are not touched
+	for (size_t i = 0; i < table->capacity; i++)
+	{
+		const struct InternSlot *slot = &table->slots[i];
+		if (slot->string == NULL)
+			continue;
+
+		size_t index = slot->hash & (capacity - 1);
+		while (slots[index].string != NULL)
+			index = (index + 1) & (capacity - 1);
+		slots[index] = *slot;
+	}
+
+	table->slots	= slots;
+	table->capacity	= capacity;
+	return 1;
+}
+
+void intern_init(InternTable *table, LinearAllocator *arena, const size_t capacity)
+{
+	M_ASSERT(table != NULL, "Intern table is NULL");
+	M_ASSERT(arena != NULL, "Linear Allocator is NULL");
+	table->arena	= arena;
+	table->slots	= NULL;
+	table->count	= 0;
+	table->capacity	= 0;
+
+	// room for 'capacity' strings without growing
+	size_t slots = MIN_INTERN_CAPACITY;
+	while (slots < 2 * capacity)
+		slots <<= 1;
+	intern_grow(table, slots);
+}
+
+const char *intern(InternTable *table, const char *text, const size_t length)
+{
+	M_ASSERT(table != NULL, "Intern table is NULL");
+	M_ASSERT(length <= UINT32_MAX, "String is too long");
+
+	// hits never grow the table
+	const uint32_t hash = intern_hash(text, length);
+	struct InternSlot *slot = (table->capacity != 0) ? find_slot(table, text, length, hash) : NULL;
+	if (slot != NULL && slot->string != NULL)
+		return slot->string;
+
+	// load factor stays under 1/2, probes are short
+	if (UNLIKELY(2 * (table->count + 1) > table->capacity))
+	{
+		if (!intern_grow(table, table->capacity ? 2 * table->capacity : MIN_INTERN_CAPACITY))
+		{
+			PRINT("There is no available space");
+			return NULL;
+		}
+		slot = find_slot(table, text, length, hash);
+	}
+
+	char *copy = la_alloc_aligned(table->arena, length + 1, 1);
+	if (copy == NULL)
+	{
+		PRINT("There is no available space");
+		return NULL;
+	}
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+
+	*slot = (struct InternSlot){ copy, hash, (uint32_t)length };
+	table->count++;
+	return copy;
+}
+
+const char *intern_string(InternTable *table, const char *text)
+{
+	return intern(table, text, strlen(text));
+}
+
+const char *intern_find(InternTable *table, const char *text, const size_t length)
+{
+	M_ASSERT(table != NULL, "Intern table is NULL");
+	if (table->capacity == 0)
+		return NULL;
+	return find_slot(table, text, length, intern_hash(text, length))->string;
+}
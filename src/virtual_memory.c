@@ -0,0 +1,105 @@
+#include "../include/virtual_memory.h"
+#include "../debug/debug.h"				// M_ASSERT, PRINT
+#include "../include/memory.h"				// ALIGNED_SIZE, ALIGN_POINTER
+#include <sys/mman.h>					// mmap, mprotect, madvise, munmap
+#include <unistd.h>					// sysconf
+
+#ifndef MADV_POPULATE_WRITE
+	#define MADV_POPULATE_WRITE		23
+#endif
+
+size_t vm_page_size(void)
+{
+	static size_t page_size = 0;
+	if (page_size == 0)
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+	return page_size;
+}
+
+void *vm_reserve(const size_t size)
+{
+	const size_t reserved_size = ALIGNED_SIZE(size, vm_page_size());
+	void *ptr = mmap(NULL, reserved_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (ptr == MAP_FAILED)
+	{
+		PRINT("Unable to reserve address space");
+		return NULL;
+	}
+	return ptr;
+}
+
+int vm_commit(void *ptr, const size_t size)
+{
+	M_ASSERT(((size_t)ptr & (vm_page_size() - 1)) == 0, "Pointer is not page-aligned");
+	return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void vm_decommit(void *ptr, const size_t size)
+{
+	M_ASSERT(((size_t)ptr & (vm_page_size() - 1)) == 0, "Pointer is not page-aligned");
+	madvise(ptr, size, MADV_DONTNEED);
+	mprotect(ptr, size, PROT_NONE);
+}
+
+void vm_release(void *ptr, const size_t size)
+{
+	if (ptr == NULL)
+		return;
+	munmap(ptr, ALIGNED_SIZE(size, vm_page_size()));
+}
+
+void vm_prefault(void *ptr, const size_t size)
+{
+	if (ptr == NULL || size == 0)
+		return;
+
+	// populating doesn't change contents, so pages shared with neighbours may be included
+	const size_t page_size = vm_page_size();
+	char *start = ALIGN_POINTER_DOWN(ptr, page_size);
+	char *end = ALIGN_POINTER((char *)ptr + size, page_size);
+	if (madvise(start, (size_t)(end - start), MADV_POPULATE_WRITE) == 0)
+		return;
+
+	// write fault on every page, bytes outside of the range aren't touched
+	for (volatile char *byte = ptr; byte < (char *)ptr + size; byte = ALIGN_POINTER(byte + 1, page_size))
+		*byte = *byte;
+}
+
+void *vm_map_aligned(const size_t size, const size_t alignment)
+{
+	M_ASSERT((alignment & (alignment - 1)) == 0 && alignment >= vm_page_size(), "Incorrect alignment");
+	const size_t mapped_size = ALIGNED_SIZE(size, vm_page_size());
+
+	// map more than needed and cut off unaligned head and the rest of tail
+	char *ptr = mmap(NULL, mapped_size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+	{
+		PRINT("Unable to map memory");
+		return NULL;
+	}
+
+	char *aligned = ALIGN_POINTER(ptr, alignment);
+	if (aligned != ptr)
+		munmap(ptr, (size_t)(aligned - ptr));
+	munmap(aligned + mapped_size, (size_t)(ptr + alignment - aligned));
+	return aligned;
+}
+
+char *vm_grow_committed(char *committed, const char *required, const char *end, const size_t commit_chunk)
+{
+	M_ASSERT(commit_chunk != 0, "Commit chunk is zero");
+	if (required > end)
+		return NULL;
+
+	// watermark never passes end, the last page of reservation is committed as a whole
+	char *new_committed = committed + ALIGNED_SIZE((size_t)(required - committed), commit_chunk);
+	if (new_committed > end)
+		new_committed = (char *)end;
+
+	if (!vm_commit(committed, ALIGNED_SIZE((size_t)(new_committed - committed), vm_page_size())))
+	{
+		PRINT("Unable to commit memory");
+		return NULL;
+	}
+	return new_committed;
+}
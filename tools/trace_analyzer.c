@@ -0,0 +1,398 @@
+// Reads a trace written by trace_start/trace_stop (include/allocation_trace.h) and reports
+// size and lifetime histograms, usage over time and sizes each allocator actually needed.
+//
+// usage: trace_analyzer <trace file>
+#include "../include/allocation_trace.h"	// TraceEvent, TraceFileHeader
+#include "../include/memory.h"				// ALIGNED_SIZE, DEFAULT_ALIGNMENT
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HISTOGRAM_BUCKETS		64
+#define TIMELINE_BUCKETS		20
+#define BAR_WIDTH				40
+#define LIVE_TABLE_BUCKETS		(1 << 20)
+
+// stack-like allocators keep allocation size in front of every block
+#define BLOCK_HEADER_SIZE		sizeof(size_t)
+
+static const char *kind_names[ALLOCATOR_KIND_COUNT] =
+{
+	"LinearAllocator", "StackAllocator", "PoolAllocator",
+	"DoubleBufferedAllocator", "DoubleEndedStackAllocator", "SharedPoolAllocator",
+	"GrowablePoolAllocator"
+};
+
+struct Record
+{
+	TraceEvent event;
+	size_t order;						// position in file keeps per-thread order for equal timestamps
+};
+
+struct Allocator
+{
+	uint64_t id;
+	int kind;
+	uint64_t owner;						// double-buffered allocator the stack belongs to
+	size_t allocs, frees, resets, unmatched_frees;
+	uint64_t live_bytes, live_count;
+	uint64_t peak_bytes, peak_count;
+	uint64_t max_size, max_alignment;
+	long live_list;						// first live allocation
+};
+
+struct LiveAllocation
+{
+	uint64_t ptr;
+	uint64_t footprint;
+	uint64_t timestamp;
+	size_t allocator;
+	long next_in_bucket;
+	long prev, next;					// list of allocator's live allocations
+};
+
+static struct Allocator *allocators = NULL;
+static size_t allocator_count = 0;
+
+static struct LiveAllocation *live = NULL;
+static size_t live_capacity = 0, live_used = 0;
+static long live_free_list = -1;
+static long *live_buckets = NULL;
+
+static uint64_t size_histogram[HISTOGRAM_BUCKETS];
+static uint64_t lifetime_histogram[HISTOGRAM_BUCKETS];
+static uint64_t total_live_bytes = 0;
+
+static int log2_bucket(uint64_t value)
+{
+	return value == 0 ? 0 : 63 - __builtin_clzll(value);
+}
+
+static int compare_records(const void *a, const void *b)
+{
+	const struct Record *left = (const struct Record *)a, *right = (const struct Record *)b;
+	if (left->event.timestamp != right->event.timestamp)
+		return left->event.timestamp < right->event.timestamp ? -1 : 1;
+	return left->order < right->order ? -1 : (left->order > right->order);
+}
+
+// bytes the allocation takes inside the allocator
+static uint64_t footprint(const int kind, const uint64_t size, const uint64_t alignment)
+{
+	const uint64_t block_alignment = alignment > DEFAULT_ALIGNMENT ? alignment : DEFAULT_ALIGNMENT;
+	switch (kind)
+	{
+		case ALLOCATOR_STACK:
+		case ALLOCATOR_DOUBLE_ENDED:
+			return ALIGNED_SIZE(size + BLOCK_HEADER_SIZE, block_alignment);
+		case ALLOCATOR_LINEAR:
+			return ALIGNED_SIZE(size, block_alignment);
+		default:
+			return size;
+	}
+}
+
+static size_t find_allocator(const uint64_t id, const int kind)
+{
+	// same address may be reused by another allocator later, kind tells them apart
+	for (size_t i = allocator_count; i-- > 0;)
+		if (allocators[i].id == id && allocators[i].kind == kind)
+			return i;
+
+	allocators = (struct Allocator *)realloc(allocators, (allocator_count + 1) * sizeof(struct Allocator));
+	struct Allocator *allocator = &allocators[allocator_count];
+	memset(allocator, 0, sizeof(*allocator));
+	allocator->id			= id;
+	allocator->kind			= kind;
+	allocator->live_list	= -1;
+	return allocator_count++;
+}
+
+static size_t live_bucket(const size_t allocator, const uint64_t ptr)
+{
+	return (size_t)((ptr >> 3) ^ (allocator * 0x9E3779B97F4A7C15ULL)) & (LIVE_TABLE_BUCKETS - 1);
+}
+
+static long find_live(const size_t allocator, const uint64_t ptr)
+{
+	for (long i = live_buckets[live_bucket(allocator, ptr)]; i != -1; i = live[i].next_in_bucket)
+		if (live[i].ptr == ptr && live[i].allocator == allocator)
+			return i;
+	return -1;
+}
+
+static void remove_live(const long index, const uint64_t timestamp)
+{
+	struct LiveAllocation *allocation = &live[index];
+	struct Allocator *allocator = &allocators[allocation->allocator];
+
+	lifetime_histogram[log2_bucket(timestamp - allocation->timestamp)]++;
+	allocator->live_bytes	-= allocation->footprint;
+	allocator->live_count	-= 1;
+	total_live_bytes		-= allocation->footprint;
+
+	// unlink from the bucket
+	long *link = &live_buckets[live_bucket(allocation->allocator, allocation->ptr)];
+	while (*link != index)
+		link = &live[*link].next_in_bucket;
+	*link = allocation->next_in_bucket;
+
+	// unlink from the allocator
+	if (allocation->prev != -1)
+		live[allocation->prev].next = allocation->next;
+	else
+		allocator->live_list = allocation->next;
+	if (allocation->next != -1)
+		live[allocation->next].prev = allocation->prev;
+
+	allocation->next_in_bucket = live_free_list;
+	live_free_list = index;
+}
+
+static void add_live(const size_t allocator_index, const TraceEvent *event)
+{
+	long index = live_free_list;
+	if (index != -1)
+		live_free_list = live[index].next_in_bucket;
+	else
+	{
+		if (live_used == live_capacity)
+		{
+			live_capacity	= live_capacity ? live_capacity * 2 : 4096;
+			live			= (struct LiveAllocation *)realloc(live, live_capacity * sizeof(struct LiveAllocation));
+		}
+		index = (long)live_used++;
+	}
+
+	struct Allocator *allocator = &allocators[allocator_index];
+	const uint64_t alignment = event->alignment_log2 ? (1ULL << event->alignment_log2) : 0;
+
+	struct LiveAllocation *allocation = &live[index];
+	allocation->ptr			= event->ptr;
+	allocation->footprint	= footprint(allocator->kind, event->size, alignment);
+	allocation->timestamp	= event->timestamp;
+	allocation->allocator	= allocator_index;
+
+	const size_t bucket = live_bucket(allocator_index, event->ptr);
+	allocation->next_in_bucket	= live_buckets[bucket];
+	live_buckets[bucket]		= index;
+
+	allocation->prev	= -1;
+	allocation->next	= allocator->live_list;
+	if (allocator->live_list != -1)
+		live[allocator->live_list].prev = index;
+	allocator->live_list = index;
+
+	allocator->allocs++;
+	allocator->live_bytes	+= allocation->footprint;
+	allocator->live_count	+= 1;
+	total_live_bytes		+= allocation->footprint;
+	if (allocator->live_bytes > allocator->peak_bytes)
+		allocator->peak_bytes = allocator->live_bytes;
+	if (allocator->live_count > allocator->peak_count)
+		allocator->peak_count = allocator->live_count;
+	if (event->size > allocator->max_size)
+		allocator->max_size = event->size;
+	if (alignment > allocator->max_alignment)
+		allocator->max_alignment = alignment;
+
+	size_histogram[log2_bucket(event->size)]++;
+}
+
+static void process_event(const TraceEvent *event)
+{
+	const size_t index = find_allocator(event->allocator, event->kind);
+	long allocation;
+
+	switch (event->type)
+	{
+		case TRACE_ALLOC:
+			// previous free of the same address was dropped
+			if ((allocation = find_live(index, event->ptr)) != -1)
+				remove_live(allocation, event->timestamp);
+			add_live(index, event);
+			break;
+		case TRACE_FREE:
+			allocators[index].frees++;
+			if ((allocation = find_live(index, event->ptr)) != -1)
+				remove_live(allocation, event->timestamp);
+			else
+				allocators[index].unmatched_frees++;
+			break;
+		case TRACE_RESET:
+			allocators[index].resets++;
+			for (long i = allocators[index].live_list, next; i != -1; i = next)
+			{
+				next = live[i].next;
+				if (event->ptr == 0 || (live[i].ptr >= event->ptr && live[i].ptr < event->ptr + event->size))
+					remove_live(i, event->timestamp);
+			}
+			break;
+		case TRACE_SWAP:
+			allocators[find_allocator(event->ptr, ALLOCATOR_STACK)].owner = event->allocator;
+			break;
+	}
+}
+
+static void print_bar(const uint64_t value, const uint64_t max)
+{
+	const int length = max ? (int)(value * BAR_WIDTH / max) : 0;
+	for (int i = 0; i < length; i++)
+		putchar('#');
+	putchar('\n');
+}
+
+static void print_histogram(const char *title, const uint64_t *histogram, const char *unit)
+{
+	uint64_t max = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+		if (histogram[i] > max)
+			max = histogram[i];
+
+	printf("\n%s\n", title);
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		if (histogram[i] == 0)
+			continue;
+		printf("  [%20llu, %20llu) %s %10llu ", i ? 1ULL << i : 0ULL, i < 63 ? 1ULL << (i + 1) : ~0ULL, unit, (unsigned long long)histogram[i]);
+		print_bar(histogram[i], max);
+	}
+}
+
+static void print_recommendations(void)
+{
+	printf("\nALLOCATORS\n");
+	for (size_t i = 0; i < allocator_count; i++)
+	{
+		const struct Allocator *allocator = &allocators[i];
+		if (allocator->kind >= ALLOCATOR_KIND_COUNT)
+			continue;
+
+		printf("  %s 0x%llx", kind_names[allocator->kind], (unsigned long long)allocator->id);
+		if (allocator->owner)
+			printf(" (buffer of DoubleBufferedAllocator 0x%llx)", (unsigned long long)allocator->owner);
+		printf("\n    allocs %zu, frees %zu, resets %zu, unmatched frees %zu\n",
+			allocator->allocs, allocator->frees, allocator->resets, allocator->unmatched_frees);
+		printf("    peak %llu bytes in %llu allocations, max size %llu, max alignment %llu\n",
+			(unsigned long long)allocator->peak_bytes, (unsigned long long)allocator->peak_count,
+			(unsigned long long)allocator->max_size, (unsigned long long)allocator->max_alignment);
+
+		switch (allocator->kind)
+		{
+			case ALLOCATOR_POOL:
+			case ALLOCATOR_SHARED_POOL:
+				printf("    ideal pool: %llu elements of %llu bytes\n",
+					(unsigned long long)allocator->peak_count, (unsigned long long)allocator->max_size);
+				break;
+			case ALLOCATOR_GROWABLE_POOL:
+				printf("    peak %llu elements of %llu bytes, grows on demand\n",
+					(unsigned long long)allocator->peak_count, (unsigned long long)allocator->max_size);
+				break;
+			case ALLOCATOR_DOUBLE_BUFFERED:
+			{
+				// both buffers have the same size, the busier one decides
+				uint64_t peak = 0;
+				for (size_t j = 0; j < allocator_count; j++)
+					if (allocators[j].owner == allocator->id && allocators[j].peak_bytes > peak)
+						peak = allocators[j].peak_bytes;
+				printf("    ideal size of each buffer: %llu bytes\n", (unsigned long long)peak);
+				break;
+			}
+			default:
+				printf("    ideal arena size: %llu bytes\n", (unsigned long long)allocator->peak_bytes);
+				break;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (file == NULL)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+
+	TraceFileHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_FILE_MAGIC ||
+		header.version != TRACE_FILE_VERSION || header.event_size != sizeof(TraceEvent))
+	{
+		fprintf(stderr, "%s: not a trace file or unsupported version\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	struct Record *records = NULL;
+	size_t count = 0, capacity = 0;
+	TraceEvent event;
+	while (fread(&event, sizeof(event), 1, file) == 1)
+	{
+		if (count == capacity)
+		{
+			capacity	= capacity ? capacity * 2 : 4096;
+			records		= (struct Record *)realloc(records, capacity * sizeof(struct Record));
+		}
+		records[count].event = event;
+		records[count].order = count;
+		count++;
+	}
+	fclose(file);
+
+	if (count == 0)
+	{
+		printf("trace is empty\n");
+		return 0;
+	}
+	qsort(records, count, sizeof(struct Record), compare_records);
+
+	live_buckets = (long *)malloc(LIVE_TABLE_BUCKETS * sizeof(long));
+	memset(live_buckets, 0xFF, LIVE_TABLE_BUCKETS * sizeof(long));
+
+	// peak of all live bytes in equal time slices
+	const uint64_t first = records[0].event.timestamp;
+	const uint64_t duration = records[count - 1].event.timestamp - first + 1;
+	uint64_t timeline[TIMELINE_BUCKETS] = { 0 };
+	uint64_t overall_peak = 0;
+	size_t last_slice = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		// slices without events keep what was live before
+		const size_t slice = (size_t)((records[i].event.timestamp - first) * TIMELINE_BUCKETS / duration);
+		for (; last_slice + 1 < slice; last_slice++)
+			timeline[last_slice + 1] = total_live_bytes;
+		last_slice = slice;
+
+		process_event(&records[i].event);
+		if (total_live_bytes > timeline[slice])
+			timeline[slice] = total_live_bytes;
+		if (total_live_bytes > overall_peak)
+			overall_peak = total_live_bytes;
+	}
+
+	printf("%zu events over %.3f ms\n", count, duration / 1e6);
+	print_histogram("ALLOCATION SIZES", size_histogram, "bytes");
+	print_histogram("LIFETIMES", lifetime_histogram, "ns   ");
+
+	printf("\nLIVE BYTES OVER TIME (peak %llu)\n", (unsigned long long)overall_peak);
+	for (int i = 0; i < TIMELINE_BUCKETS; i++)
+	{
+		printf("  %10.3f ms %12llu ", (double)duration * i / TIMELINE_BUCKETS / 1e6, (unsigned long long)timeline[i]);
+		print_bar(timeline[i], overall_peak);
+	}
+
+	print_recommendations();
+
+	free(records);
+	free(live);
+	free(live_buckets);
+	free(allocators);
+	return 0;
+}